@@ -0,0 +1,1394 @@
+// Micro benchmarks for the containers from src/.
+// Usage: ./benchmark [name...], runs every benchmark when no names are given.
+
+#include "entry_point.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// The entry arrays of the tables come from malloc/realloc, not operator new, so live bytes are asked from
+// the allocator. mallinfo2() is glibc-only (2.33 and later); other C libraries fall back to counting the
+// memory of operator new, which misses those arrays and understates every table built on HashTable.
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+#define BENCHMARK_HAS_MALLINFO2 1
+#else
+#define BENCHMARK_HAS_MALLINFO2 0
+#endif
+
+namespace {
+    std::atomic<size_t> allocationsCount = 0;
+
+#if BENCHMARK_HAS_MALLINFO2
+    // Bytes held through malloc, which serves operator new as well as the entry arrays of the tables.
+    size_t LiveBytes() {
+        const auto info = mallinfo2();
+
+        return info.uordblks + info.hblkhd;
+    }
+#else
+    std::atomic<size_t> operatorNewBytes = 0;
+
+    size_t LiveBytes() {
+        return operatorNewBytes.load();
+    }
+#endif
+}
+
+void *operator new(size_t size) {
+    auto *memory = std::malloc(size == 0 ? 1 : size);
+
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+
+#if !BENCHMARK_HAS_MALLINFO2
+    operatorNewBytes += malloc_usable_size(memory);
+#endif
+    allocationsCount++;
+
+    return memory;
+}
+
+// Kept out of line, inlined into callers the free() of memory from operator new trips -Wmismatched-new-delete.
+[[gnu::noinline]] void operator delete(void *memory) noexcept {
+#if !BENCHMARK_HAS_MALLINFO2
+    if (memory != nullptr) {
+        operatorNewBytes -= malloc_usable_size(memory);
+    }
+#endif
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+namespace Benchmarks {
+    constexpr size_t ElementsCount = 1'000'000;
+
+    template <class Action>
+    double MeasureSeconds(Action action) {
+        const auto start = std::chrono::steady_clock::now();
+        action();
+        const auto finish = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double>(finish - start).count();
+    }
+
+    // Read-only passes are repeated and the fastest one is taken, the machine is rarely quiet.
+    template <class Action>
+    double MeasureBestSeconds(Action action, int repeats = 5) {
+        auto best = MeasureSeconds(action);
+
+        for (int i = 1; i < repeats; i++) {
+            best = std::min(best, MeasureSeconds(action));
+        }
+
+        return best;
+    }
+
+    void Report(const char *benchmark, const std::string &subject, double value, const char *unit) {
+        std::printf("%-16s %-44s %14.2f %s\n", benchmark, subject.c_str(), value, unit);
+    }
+
+    std::vector<uint64_t> RandomKeys(size_t count, uint64_t seed) {
+        std::mt19937_64 random(seed);
+        std::vector<uint64_t> keys(count);
+
+        for (auto &key : keys) {
+            key = random();
+        }
+
+        return keys;
+    }
+
+    std::vector<std::string> RandomStrings(size_t count, size_t length, uint64_t seed) {
+        std::mt19937_64 random(seed);
+        std::vector<std::string> keys(count);
+
+        for (auto &key : keys) {
+            key.resize(length);
+
+            for (auto &symbol : key) {
+                symbol = static_cast<char>('a' + random() % 26);
+            }
+        }
+
+        return keys;
+    }
+
+    // Keys drawn from [0, universe) with probability of the key k proportional to 1 / (k + 1)^skew.
+    std::vector<uint64_t> ZipfianKeys(size_t count, size_t universe, double skew, uint64_t seed) {
+        std::vector<double> cumulative(universe);
+        double total = 0;
+
+        for (size_t k = 0; k < universe; k++) {
+            total += 1.0 / std::pow(static_cast<double>(k + 1), skew);
+            cumulative[k] = total;
+        }
+
+        std::mt19937_64 random(seed);
+        std::uniform_real_distribution<double> distribution(0, total);
+        std::vector<uint64_t> keys(count);
+
+        for (auto &key : keys) {
+            const auto position = std::upper_bound(cumulative.begin(), cumulative.end(), distribution(random));
+            // Scatter ranks so that hot keys are not neighbours.
+            key = static_cast<uint64_t>(position - cumulative.begin()) * 0x9E3779B97F4A7C15ull;
+        }
+
+        return keys;
+    }
+
+    // Inserts every key, then looks up every key once; reports memory held by the container too.
+    template <class TContainer, class TKey, class Insert>
+    void MeasureDedup(const char *benchmark, const std::string &subject, const std::vector<TKey> &keys, Insert insert) {
+        const auto bytesBefore = LiveBytes();
+        const auto allocationsBefore = allocationsCount.load();
+        TContainer container;
+
+        const auto insertSeconds = MeasureSeconds([&] {
+            for (const auto &key : keys) {
+                insert(container, key);
+            }
+        });
+
+        const auto bytes = LiveBytes() - bytesBefore;
+        const auto allocations = allocationsCount.load() - allocationsBefore;
+        size_t found = 0;
+
+        const auto lookupSeconds = MeasureBestSeconds([&] {
+            for (const auto &key : keys) {
+                found += container.find(key) != container.end();
+            }
+        });
+
+        if (found == 0) {
+            std::abort();
+        }
+
+        Report(benchmark, subject + " bytes/key", static_cast<double>(bytes) / container.size(), "B");
+        Report(benchmark, subject + " allocations/key", static_cast<double>(allocations) / container.size(), "");
+        Report(benchmark, subject + " insert", keys.size() / insertSeconds / 1e6, "Mops/s");
+        Report(benchmark, subject + " lookup", keys.size() / lookupSeconds / 1e6, "Mops/s");
+    }
+
+    void SetAgainstMapOfBool() {
+        const auto integers = RandomKeys(ElementsCount, 1);
+        const auto strings = RandomStrings(ElementsCount, 24, 2);
+
+        MeasureDedup<HashMap<uint64_t, bool>>("set", "HashMap<uint64_t, bool>", integers, [](auto &map, auto key) {
+            map.insert(std::make_pair(key, true));
+        });
+        MeasureDedup<HashSet<uint64_t>>("set", "HashSet<uint64_t>", integers, [](auto &set, auto key) {
+            set.insert(key);
+        });
+        MeasureDedup<HashMap<std::string, bool>>("set", "HashMap<string, bool>", strings, [](auto &map, const auto &key) {
+            map.insert(std::make_pair(key, true));
+        });
+        MeasureDedup<HashSet<std::string>>("set", "HashSet<string>", strings, [](auto &set, const auto &key) {
+            set.insert(key);
+        });
+    }
+
+    // One-to-many index: every key gets several values, then all values of every key are scanned.
+    template <class TContainer, class Insert, class Sum>
+    void MeasureIndex(const std::string &subject, const std::vector<uint64_t> &owners, Insert insert, Sum sum) {
+        const auto bytesBefore = LiveBytes();
+        const auto allocationsBefore = allocationsCount.load();
+        TContainer container;
+
+        const auto insertSeconds = MeasureSeconds([&] {
+            for (size_t i = 0; i < owners.size(); i++) {
+                insert(container, owners[i], i);
+            }
+        });
+
+        const auto bytes = LiveBytes() - bytesBefore;
+        const auto allocations = allocationsCount.load() - allocationsBefore;
+        uint64_t total = 0;
+
+        const auto scanSeconds = MeasureBestSeconds([&] {
+            for (auto owner : owners) {
+                total += sum(container, owner);
+            }
+        });
+
+        if (total == 0) {
+            std::abort();
+        }
+
+        Report("multimap", subject + " bytes/value", static_cast<double>(bytes) / owners.size(), "B");
+        Report("multimap", subject + " allocations/value", static_cast<double>(allocations) / owners.size(), "");
+        Report("multimap", subject + " insert", owners.size() / insertSeconds / 1e6, "Mops/s");
+        Report("multimap", subject + " scan key values", owners.size() / scanSeconds / 1e6, "Mkeys/s");
+    }
+
+    void MultiMapAgainstMapOfVectors() {
+        constexpr size_t KeysCount = ElementsCount / 5;
+        auto owners = RandomKeys(ElementsCount, 3);
+
+        for (auto &owner : owners) {
+            owner %= KeysCount;
+        }
+
+        MeasureIndex<HashMap<uint64_t, std::vector<uint64_t>>>(
+            "HashMap<uint64_t, vector<uint64_t>>", owners,
+            [](auto &map, uint64_t owner, uint64_t value) {
+                map[owner].push_back(value);
+            },
+            [](auto &map, uint64_t owner) {
+                uint64_t sum = 0;
+                for (auto value : map.find(owner)->second) {
+                    sum += value;
+                }
+                return sum;
+            });
+        MeasureIndex<HashMultiMap<uint64_t, uint64_t>>(
+            "HashMultiMap<uint64_t, uint64_t>", owners,
+            [](auto &map, uint64_t owner, uint64_t value) {
+                map.insert(owner, value);
+            },
+            [](auto &map, uint64_t owner) {
+                uint64_t sum = 0;
+                for (auto value : map.values(owner)) {
+                    sum += value;
+                }
+                return sum;
+            });
+    }
+
+    // Many tiny maps, like per-object attribute bags; the maps themselves are counted as well.
+    template <class TMap>
+    void MeasureSmallMaps(const std::string &subject, size_t mapsCount, int pairsCount) {
+        const auto bytesBefore = LiveBytes();
+        const auto allocationsBefore = allocationsCount.load();
+        std::vector<TMap> maps(mapsCount);
+
+        const auto buildSeconds = MeasureSeconds([&] {
+            for (auto &map : maps) {
+                for (int i = 0; i < pairsCount; i++) {
+                    map[i * 7919] = i;
+                }
+            }
+        });
+
+        const auto bytes = LiveBytes() - bytesBefore;
+        const auto allocations = allocationsCount.load() - allocationsBefore;
+        long long sum = 0;
+
+        const auto lookupSeconds = MeasureBestSeconds([&] {
+            for (auto &map : maps) {
+                for (int i = 0; i < pairsCount; i++) {
+                    sum += map.find(i * 7919)->second;
+                }
+            }
+        });
+
+        if (sum == 0) {
+            std::abort();
+        }
+
+        const auto operations = static_cast<double>(mapsCount * pairsCount);
+
+        Report("small", subject + " bytes/map", static_cast<double>(bytes) / mapsCount, "B");
+        Report("small", subject + " allocations/map", static_cast<double>(allocations) / mapsCount, "");
+        Report("small", subject + " build", operations / buildSeconds / 1e6, "Mops/s");
+        Report("small", subject + " lookup", operations / lookupSeconds / 1e6, "Mops/s");
+    }
+
+    void SmallMapAgainstHashMap() {
+        constexpr size_t MapsCount = 200'000;
+
+        for (int pairsCount : {2, 5, 8}) {
+            const auto suffix = " x" + std::to_string(pairsCount);
+
+            MeasureSmallMaps<HashMap<int, int>>("HashMap<int, int>" + suffix, MapsCount, pairsCount);
+            MeasureSmallMaps<SmallHashMap<int, int, 4>>("SmallHashMap<int, int, 4>" + suffix, MapsCount, pairsCount);
+            MeasureSmallMaps<SmallHashMap<int, int, 8>>("SmallHashMap<int, int, 8>" + suffix, MapsCount, pairsCount);
+        }
+    }
+
+    // The usual way of bolting LRU onto a map: recency list plus a map of list positions.
+    class ListLruCache {
+    public:
+        explicit ListLruCache(size_t maxSize) : maxSize(maxSize) {
+        }
+
+        template <class Loader>
+        uint64_t &get_or_load(uint64_t key, Loader loader) {
+            auto position = positions.find(key);
+
+            if (position != positions.end()) {
+                recency.splice(recency.begin(), recency, position->second);
+
+                return position->second->second;
+            }
+
+            if (recency.size() == maxSize) {
+                positions.erase(positions.find(recency.back().first));
+                recency.pop_back();
+            }
+
+            recency.emplace_front(key, loader(key));
+            positions[key] = recency.begin();
+
+            return recency.front().second;
+        }
+
+    private:
+        size_t maxSize;
+        std::list<std::pair<uint64_t, uint64_t>> recency;
+        HashMap<uint64_t, std::list<std::pair<uint64_t, uint64_t>>::iterator> positions;
+    };
+
+    template <class TCache>
+    void MeasureCache(const std::string &subject, const std::vector<uint64_t> &requests, size_t cacheSize) {
+        const auto bytesBefore = LiveBytes();
+        size_t loads = 0;
+        uint64_t sum = 0;
+        TCache cache(cacheSize);
+
+        const auto seconds = MeasureSeconds([&] {
+            for (auto key : requests) {
+                sum += cache.get_or_load(key, [&loads](uint64_t loaded) {
+                    loads++;
+                    return loaded >> 7;
+                });
+            }
+        });
+
+        const auto bytes = LiveBytes() - bytesBefore;
+
+        if (sum == 0) {
+            std::abort();
+        }
+
+        Report("cache", subject + " hit ratio", 100.0 * (requests.size() - loads) / requests.size(), "%");
+        Report("cache", subject + " requests", requests.size() / seconds / 1e6, "Mops/s");
+        Report("cache", subject + " bytes/entry", static_cast<double>(bytes) / cacheSize, "B");
+    }
+
+    void ClockCacheAgainstListLru() {
+        constexpr size_t Universe = ElementsCount;
+
+        for (double skew : {0.8, 0.99, 1.2}) {
+            const auto requests = ZipfianKeys(4 * ElementsCount, Universe, skew, 4);
+            const auto suffix = " zipf " + std::to_string(skew).substr(0, 4);
+
+            MeasureCache<ListLruCache>("HashMap + std::list LRU" + suffix, requests, Universe / 10);
+            MeasureCache<ClockCache<uint64_t, uint64_t>>("ClockCache" + suffix, requests, Universe / 10);
+        }
+    }
+
+    // Counts data TLB read misses of the calling thread; unavailable under restrictive perf_event_paranoid.
+    class DtlbMissCounter {
+    public:
+        DtlbMissCounter() {
+            perf_event_attr attributes{};
+            attributes.type = PERF_TYPE_HW_CACHE;
+            attributes.size = sizeof(attributes);
+            attributes.config = PERF_COUNT_HW_CACHE_DTLB
+                                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+
+            descriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+        }
+
+        DtlbMissCounter(const DtlbMissCounter &other) = delete;
+
+        DtlbMissCounter &operator=(const DtlbMissCounter &other) = delete;
+
+        ~DtlbMissCounter() {
+            if (descriptor != -1) {
+                close(descriptor);
+            }
+        }
+
+        [[nodiscard]] bool available() const {
+            return descriptor != -1;
+        }
+
+        template <class Action>
+        uint64_t Count(Action action) {
+            uint64_t misses = 0;
+
+            ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+            ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+            action();
+            ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+
+            if (read(descriptor, &misses, sizeof(misses)) != sizeof(misses)) {
+                return 0;
+            }
+
+            return misses;
+        }
+
+    private:
+        int descriptor;
+    };
+
+    // Lookups of present keys touch entries and nodes, lookups of absent keys touch only buckets and entries.
+    void MeasureLargeTable(const std::string &subject, const HashMapOptions &options,
+                           const std::vector<uint64_t> &keys, const std::vector<uint64_t> &absent) {
+        HashMap<uint64_t, uint64_t> map(options);
+
+        const auto buildSeconds = MeasureSeconds([&] {
+            for (auto key : keys) {
+                map[key] = key >> 3;
+            }
+        });
+
+        uint64_t sum = 0;
+        size_t found = 0;
+        const auto hitSeconds = MeasureBestSeconds([&] {
+            for (auto key : keys) {
+                sum += map.find(key)->second;
+            }
+        }, 3);
+        const auto missSeconds = MeasureBestSeconds([&] {
+            for (auto key : absent) {
+                found += map.contains(key);
+            }
+        }, 3);
+
+        if (sum == 0 || found != 0) {
+            std::abort();
+        }
+
+        Report("hugepages", subject + " build", keys.size() / buildSeconds / 1e6, "Mops/s");
+        Report("hugepages", subject + " hit lookup", keys.size() / hitSeconds / 1e6, "Mops/s");
+        Report("hugepages", subject + " miss lookup", absent.size() / missSeconds / 1e6, "Mops/s");
+
+        DtlbMissCounter counter;
+
+        if (!counter.available()) {
+            std::printf("%-16s %-44s %14s\n", "hugepages", (subject + " dTLB misses/lookup").c_str(), "n/a");
+
+            return;
+        }
+
+        const auto hitMisses = counter.Count([&] {
+            for (auto key : keys) {
+                sum += map.find(key)->second;
+            }
+        });
+        const auto missMisses = counter.Count([&] {
+            for (auto key : absent) {
+                found += map.contains(key);
+            }
+        });
+
+        Report("hugepages", subject + " dTLB misses/hit lookup", static_cast<double>(hitMisses) / keys.size(), "");
+        Report("hugepages", subject + " dTLB misses/miss lookup", static_cast<double>(missMisses) / absent.size(), "");
+    }
+
+    void HugePagesAgainstRegularAllocation() {
+        constexpr size_t Count = 8 * ElementsCount;
+
+        const auto keys = RandomKeys(Count, 5);
+        const auto absent = RandomKeys(Count, 6);
+
+        HashMapOptions regular;
+        regular.hugePageMinBytes = SIZE_MAX;
+
+        MeasureLargeTable("HashMap 8M regular arrays", regular, keys, absent);
+        MeasureLargeTable("HashMap 8M huge page arrays", HashMapOptions(), keys, absent);
+    }
+
+    // Mostly unsuccessful probes, as in a filter in front of a slower store.
+    template <class TMap>
+    void MeasureProbes(const std::string &subject, const std::vector<uint64_t> &keys, const std::vector<uint64_t> &absent) {
+        TMap map;
+
+        for (auto key : keys) {
+            map[key] = key >> 3;
+        }
+
+        uint64_t sum = 0;
+        size_t found = 0;
+        const auto hitSeconds = MeasureBestSeconds([&] {
+            for (auto key : keys) {
+                sum += map.find(key)->second;
+            }
+        }, 3);
+        const auto missSeconds = MeasureBestSeconds([&] {
+            for (auto key : absent) {
+                found += map.contains(key);
+            }
+        }, 3);
+
+        if (sum == 0 || found != 0) {
+            std::abort();
+        }
+
+        Report("layout", subject + " hit lookup", keys.size() / hitSeconds / 1e6, "Mops/s");
+        Report("layout", subject + " miss lookup", absent.size() / missSeconds / 1e6, "Mops/s");
+    }
+
+    void SplitLayoutAgainstInterleaved() {
+        for (size_t count : {ElementsCount, 8 * ElementsCount}) {
+            const auto keys = RandomKeys(count, 7);
+            const auto absent = RandomKeys(count, 8);
+            const auto suffix = " " + std::to_string(count / ElementsCount) + "M";
+
+            MeasureProbes<HashMap<uint64_t, uint64_t>>("HashMap" + suffix, keys, absent);
+            MeasureProbes<SplitHashMap<uint64_t, uint64_t>>("SplitHashMap" + suffix, keys, absent);
+        }
+    }
+
+    // Readers take a fresh view of a config map after every batch of updates to scattered keys.
+    void SnapshotAgainstCopy() {
+        constexpr int Rounds = 50;
+        constexpr int UpdatesPerRound = 100;
+
+        const auto keys = RandomKeys(ElementsCount, 9);
+        HashMap<uint64_t, uint64_t> copied;
+        SnapshotHashMap<uint64_t, uint64_t> shared;
+
+        for (auto key : keys) {
+            copied[key] = key;
+            shared.insert_or_assign(key, key);
+        }
+
+        size_t viewsSize = 0;
+        const auto copySeconds = MeasureSeconds([&] {
+            for (int round = 0; round < Rounds; round++) {
+                const HashMap<uint64_t, uint64_t> view(copied);
+                viewsSize += view.size();
+
+                for (int i = 0; i < UpdatesPerRound; i++) {
+                    copied[keys[(round * UpdatesPerRound + i) * 9973 % ElementsCount]] = i;
+                }
+            }
+        });
+        const auto snapshotSeconds = MeasureSeconds([&] {
+            for (int round = 0; round < Rounds; round++) {
+                const auto view = shared.snapshot();
+                viewsSize += view.size();
+
+                for (int i = 0; i < UpdatesPerRound; i++) {
+                    shared.insert_or_assign(keys[(round * UpdatesPerRound + i) * 9973 % ElementsCount], i);
+                }
+            }
+        });
+
+        if (viewsSize != 2 * Rounds * ElementsCount) {
+            std::abort();
+        }
+
+        Report("snapshot", "HashMap copy per round", copySeconds / Rounds * 1e6, "us");
+        Report("snapshot", "SnapshotHashMap snapshot per round", snapshotSeconds / Rounds * 1e6, "us");
+        Report("snapshot", "SnapshotHashMap pages copied per update",
+               static_cast<double>(shared.copied_pages()) / (Rounds * UpdatesPerRound), "");
+
+        uint64_t sum = 0;
+        const auto view = shared.snapshot();
+        const auto lookupSeconds = MeasureBestSeconds([&] {
+            for (auto key : keys) {
+                sum += *view.get(key);
+            }
+        });
+        const auto mapLookupSeconds = MeasureBestSeconds([&] {
+            for (auto key : keys) {
+                sum += copied.find(key)->second;
+            }
+        });
+
+        if (sum == 0) {
+            std::abort();
+        }
+
+        Report("snapshot", "HashMap lookup", keys.size() / mapLookupSeconds / 1e6, "Mops/s");
+        Report("snapshot", "SnapshotHashMap snapshot lookup", keys.size() / lookupSeconds / 1e6, "Mops/s");
+    }
+
+    template <class Hash>
+    void MeasureHashThroughput(const std::string &subject, size_t length) {
+        const auto keys = RandomStrings((64u << 20) / (length + 64), length, 10);
+        const Hash hash;
+        size_t folded = 0;
+
+        const auto seconds = MeasureBestSeconds([&] {
+            for (const auto &key : keys) {
+                folded ^= hash(key);
+            }
+        });
+
+        if (folded == 0) {
+            std::abort();
+        }
+
+        Report("hash", subject + " " + std::to_string(length) + " B keys", keys.size() * length / seconds / 1e9, "GB/s");
+    }
+
+    // Chain lengths weighted by the keys in them: the expected number of entries a successful lookup walks.
+    template <class TMap>
+    void MeasureChains(const std::string &subject, const std::vector<uint64_t> &keys) {
+        TMap map;
+
+        for (auto key : keys) {
+            map[key] = 1;
+        }
+
+        size_t walked = 0;
+        size_t longest = 0;
+        size_t empty = 0;
+
+        for (size_t bucket = 0; bucket < map.bucket_count(); bucket++) {
+            const auto length = map.bucket_size(bucket);
+
+            walked += length * (length + 1) / 2;
+            longest = std::max(longest, length);
+            empty += length == 0;
+        }
+
+        Report("hash", subject + " entries per hit", static_cast<double>(walked) / map.size(), "");
+        Report("hash", subject + " longest chain", static_cast<double>(longest), "");
+        Report("hash", subject + " empty buckets", 100.0 * empty / map.bucket_count(), "%");
+    }
+
+    void FastHashAgainstStdHash() {
+        for (size_t length : {8, 32, 128, 1024}) {
+            MeasureHashThroughput<std::hash<std::string>>("std::hash", length);
+            MeasureHashThroughput<FastHash<std::string>>("FastHash", length);
+        }
+
+        // Keys that differ only in high bits, like shifted ids or aligned addresses, and sequential ones.
+        std::vector<uint64_t> shifted(ElementsCount), sequential(ElementsCount);
+
+        for (size_t i = 0; i < ElementsCount; i++) {
+            shifted[i] = static_cast<uint64_t>(i) << 40;
+            sequential[i] = i;
+        }
+
+        MeasureChains<HashMap<uint64_t, int>>("std::hash shifted ids", shifted);
+        MeasureChains<HashMap<uint64_t, int, FastHash<uint64_t>>>("FastHash shifted ids", shifted);
+        MeasureChains<HashMap<uint64_t, int>>("std::hash sequential ids", sequential);
+        MeasureChains<HashMap<uint64_t, int, FastHash<uint64_t>>>("FastHash sequential ids", sequential);
+
+        // Keys sharing a stride with the final table size all fall into one bucket under the identity hash.
+        constexpr size_t StridedCount = 20'000;
+        HashMap<uint64_t, int> sized;
+
+        for (size_t i = 0; i < StridedCount; i++) {
+            sized[i] = 1;
+        }
+
+        std::vector<uint64_t> strided(StridedCount);
+
+        for (size_t i = 0; i < StridedCount; i++) {
+            strided[i] = i * sized.bucket_count();
+        }
+
+        MeasureChains<HashMap<uint64_t, int>>("std::hash table-sized stride", strided);
+        MeasureChains<HashMap<uint64_t, int, FastHash<uint64_t>>>("FastHash table-sized stride", strided);
+    }
+
+    template <class Count>
+    void MeasureWordCount(const std::string &subject, const std::vector<std::string> &words, Count count) {
+        size_t distinct = 0;
+
+        const auto seconds = MeasureBestSeconds([&] {
+            HashMap<std::string, int> counts;
+
+            for (const auto &word : words) {
+                count(counts, word);
+            }
+
+            distinct = counts.size();
+        });
+
+        if (distinct == 0) {
+            std::abort();
+        }
+
+        Report("upsert", subject, words.size() / seconds / 1e6, "Mwords/s");
+    }
+
+    void WordCountUpserts() {
+        constexpr size_t Vocabulary = 100'000;
+
+        const auto vocabulary = RandomStrings(Vocabulary, 8, 11);
+        std::vector<std::string> words;
+
+        for (auto rank : ZipfianKeys(4 * ElementsCount, Vocabulary, 1.0, 12)) {
+            words.push_back(vocabulary[rank % Vocabulary]);
+        }
+
+        // What callers had to do while try_emplace returned end() for present keys.
+        MeasureWordCount("try_emplace, then find", words, [](HashMap<std::string, int> &counts, const std::string &word) {
+            if (!counts.try_emplace(word, 1).first) {
+                counts.find(word)->second++;
+            }
+        });
+        MeasureWordCount("find, then insert", words, [](HashMap<std::string, int> &counts, const std::string &word) {
+            auto position = counts.find(word);
+
+            if (position != counts.end()) {
+                position->second++;
+            } else {
+                counts.insert(std::make_pair(word, 1));
+            }
+        });
+        MeasureWordCount("try_emplace returning existing", words, [](HashMap<std::string, int> &counts, const std::string &word) {
+            auto [inserted, position] = counts.try_emplace(word, 1);
+
+            if (!inserted) {
+                position->second++;
+            }
+        });
+        MeasureWordCount("emplace_or_update", words, [](HashMap<std::string, int> &counts, const std::string &word) {
+            counts.emplace_or_update(word, [](int &count) { count++; }, 1);
+        });
+    }
+
+    void AggregatorScaling() {
+        constexpr size_t BatchLength = ElementsCount;
+        constexpr size_t BatchesCount = 8;
+
+        for (size_t cardinality : {size_t(1000), ElementsCount}) {
+            std::vector<std::vector<std::pair<uint64_t, uint64_t>>> batches(BatchesCount);
+            std::mt19937_64 random(13);
+
+            for (auto &batch : batches) {
+                for (size_t i = 0; i < BatchLength; i++) {
+                    batch.emplace_back(random() % cardinality, i);
+                }
+            }
+
+            const auto suffix = " " + std::to_string(cardinality) + " keys";
+            const auto rows = static_cast<double>(BatchLength * BatchesCount);
+            size_t groups = 0;
+
+            const auto baselineSeconds = MeasureSeconds([&] {
+                HashMap<uint64_t, uint64_t> totals;
+
+                for (const auto &batch : batches) {
+                    for (const auto &[key, value] : batch) {
+                        totals[key] += value;
+                    }
+                }
+
+                groups = totals.size();
+            });
+
+            Report("aggregate", "HashMap operator[] +=" + suffix, rows / baselineSeconds / 1e6, "Mrows/s");
+
+            for (size_t threads : {1, 2, 4, 8}) {
+                size_t aggregated = 0;
+
+                const auto seconds = MeasureSeconds([&] {
+                    ParallelAggregator<uint64_t, uint64_t> aggregator(threads);
+
+                    for (const auto &batch : batches) {
+                        aggregator.consume(batch);
+                    }
+
+                    for (const auto &partition : aggregator.finalize()) {
+                        aggregated += partition.size();
+                    }
+                });
+
+                if (aggregated != groups) {
+                    std::abort();
+                }
+
+                Report("aggregate", "ParallelAggregator " + std::to_string(threads) + " threads" + suffix,
+                       rows / seconds / 1e6, "Mrows/s");
+            }
+        }
+    }
+
+    // The usual join: a multimap from the build keys, probed row by row.
+    size_t JoinRowByRow(const std::vector<uint64_t> &build, const std::vector<uint64_t> &probe, JoinKind kind,
+                        JoinOutput &output) {
+        HashMultiMap<uint64_t, size_t> table;
+
+        for (size_t row = 0; row < build.size(); row++) {
+            table.insert(build[row], row);
+        }
+
+        for (size_t row = 0; row < probe.size(); row++) {
+            const auto matches = table.values(probe[row]);
+
+            if (kind == JoinKind::Anti) {
+                if (matches.empty()) {
+                    output.probeIndices.push_back(row);
+                }
+            } else if (kind == JoinKind::Semi) {
+                if (!matches.empty()) {
+                    output.probeIndices.push_back(row);
+                }
+            } else {
+                for (auto match : matches) {
+                    output.buildIndices.push_back(match);
+                    output.probeIndices.push_back(row);
+                }
+            }
+        }
+
+        return output.probeIndices.size();
+    }
+
+    void MeasureJoin(const std::string &subject, const std::vector<uint64_t> &build, const std::vector<uint64_t> &probe,
+                     JoinKind kind) {
+        JoinOutput output;
+        size_t expected = 0, produced = 0;
+
+        const auto rowByRowSeconds = MeasureBestSeconds([&] {
+            output.clear();
+            expected = JoinRowByRow(build, probe, kind, output);
+        }, 3);
+        const auto kernelSeconds = MeasureBestSeconds([&] {
+            HashJoin<uint64_t> join;
+
+            output.clear();
+            join.build(build);
+            produced = join.probe(probe, kind, output);
+        }, 3);
+
+        if (produced != expected) {
+            std::abort();
+        }
+
+        const auto rows = static_cast<double>(build.size() + probe.size());
+
+        Report("join", subject + " multimap row by row", rows / rowByRowSeconds / 1e6, "Mrows/s");
+        Report("join", subject + " HashJoin", rows / kernelSeconds / 1e6, "Mrows/s");
+    }
+
+    // Shaped after TPC-H at scale factor 0.25: orders with 1 to 7 lineitems each, customers with about ten orders,
+    // a third of the customers without any.
+    void HashJoinAgainstRowByRow() {
+        constexpr size_t OrdersCount = 375'000;
+        constexpr size_t CustomersCount = 37'500;
+
+        std::mt19937_64 random(14);
+        std::vector<uint64_t> orderKeys(OrdersCount), orderCustomers(OrdersCount), lineitemOrders, customerKeys(CustomersCount);
+
+        for (size_t i = 0; i < OrdersCount; i++) {
+            orderKeys[i] = i * 4 + 1;
+            orderCustomers[i] = (random() % (CustomersCount * 2 / 3)) * 3 + 1;
+
+            for (auto lines = random() % 7 + 1; lines > 0; lines--) {
+                lineitemOrders.push_back(orderKeys[i]);
+            }
+        }
+
+        std::shuffle(lineitemOrders.begin(), lineitemOrders.end(), random);
+
+        for (size_t i = 0; i < CustomersCount; i++) {
+            customerKeys[i] = i * 2 + 1;
+        }
+
+        MeasureJoin("orders x lineitem inner", orderKeys, lineitemOrders, JoinKind::Inner);
+        MeasureJoin("orders semi lineitem", lineitemOrders, orderKeys, JoinKind::Semi);
+        MeasureJoin("customer anti orders", orderCustomers, customerKeys, JoinKind::Anti);
+    }
+
+    // What loading a dump looked like before: one thread reading lines, splitting and inserting them.
+    size_t IngestSerially(const std::string &path, HashMap<std::string, std::string> &map) {
+        std::ifstream in(path, std::ios::binary);
+        std::string line;
+
+        while (std::getline(in, line)) {
+            const auto comma = line.find(',');
+
+            map.try_emplace(line.substr(0, comma), line.substr(comma + 1));
+        }
+
+        return map.size();
+    }
+
+    void MeasureIngest(const std::string &path, IngestFormat format, const char *formatName, size_t pairsCount,
+                       size_t threads) {
+        IngestOptions options;
+        IngestStats stats;
+        options.threadsCount = threads;
+
+        const auto seconds = MeasureBestSeconds([&] {
+            HashMap<std::string, std::string> map;
+
+            stats = IngestFile(path, format, map, options);
+
+            if (map.size() != pairsCount) {
+                std::abort();
+            }
+        }, 3);
+
+        const auto subject = std::string("IngestFile ") + formatName + " " + std::to_string(threads) + " threads";
+        const auto megabytes = static_cast<double>(stats.bytes) / 1e6;
+
+        Report("ingest", subject, static_cast<double>(stats.records) / seconds / 1e6, "Mrecords/s");
+        Report("ingest", subject + " read", megabytes / stats.readSeconds, "MB/s");
+        Report("ingest", subject + " parse per thread", megabytes / stats.parseSeconds, "MB/s");
+        Report("ingest", subject + " hash per thread", megabytes / stats.hashSeconds, "MB/s");
+        Report("ingest", subject + " insert", megabytes / stats.insertSeconds, "MB/s");
+    }
+
+    // Two million pairs of 16 byte keys and 8 to 24 byte values, written once as CSV and once length prefixed.
+    void IngestPipelineAgainstSerialLoad() {
+        constexpr size_t PairsCount = 2'000'000;
+
+        const auto directory = std::filesystem::temp_directory_path();
+        const auto csvPath = (directory / "benchmark_ingest.csv").string();
+        const auto binaryPath = (directory / "benchmark_ingest.bin").string();
+        const auto keys = RandomStrings(PairsCount, 16, 15);
+        const auto values = RandomStrings(PairsCount, 24, 16);
+
+        {
+            std::ofstream csv(csvPath, std::ios::binary), binary(binaryPath, std::ios::binary);
+
+            for (size_t i = 0; i < PairsCount; i++) {
+                const auto value = std::string_view(values[i]).substr(0, 8 + i % 17);
+                const uint32_t keyLength = 16, valueLength = static_cast<uint32_t>(value.size());
+
+                csv << keys[i] << ',' << value << '\n';
+                binary.write(reinterpret_cast<const char *>(&keyLength), sizeof(keyLength)).write(keys[i].data(), keyLength);
+                binary.write(reinterpret_cast<const char *>(&valueLength), sizeof(valueLength)).write(value.data(), valueLength);
+            }
+        }
+
+        const auto serialSeconds = MeasureBestSeconds([&] {
+            HashMap<std::string, std::string> map;
+
+            if (IngestSerially(csvPath, map) != PairsCount) {
+                std::abort();
+            }
+        }, 3);
+
+        Report("ingest", "getline and try_emplace csv", PairsCount / serialSeconds / 1e6, "Mrecords/s");
+
+        for (size_t threads : {size_t(1), size_t(std::max(std::thread::hardware_concurrency(), 2u))}) {
+            MeasureIngest(csvPath, IngestFormat::Csv, "csv", PairsCount, threads);
+            MeasureIngest(binaryPath, IngestFormat::LengthPrefixed, "binary", PairsCount, threads);
+        }
+
+        std::filesystem::remove(csvPath);
+        std::filesystem::remove(binaryPath);
+    }
+
+    // Costs that depend on the capacity rather than on the number of elements: filling a map from empty through
+    // every resize, and presizing a large map that ends up holding few elements before dropping it.
+    void GrowthAndSparseTables() {
+        constexpr size_t KeysCount = 4'000'000;
+        constexpr size_t SparseCapacity = 8'000'000;
+        constexpr size_t SparseCount = 1000;
+
+        const auto keys = RandomKeys(KeysCount, 17);
+
+        const auto growSeconds = MeasureBestSeconds([&] {
+            HashMap<uint64_t, uint64_t> map;
+
+            for (auto key : keys) {
+                map.try_emplace(key, key);
+            }
+        }, 3);
+
+        Report("growth", "insert 4M keys into an empty map", KeysCount / growSeconds / 1e6, "Mops/s");
+
+        const auto sparseSeconds = MeasureBestSeconds([&] {
+            HashMap<uint64_t, uint64_t> map;
+
+            map.reserve(SparseCapacity);
+
+            for (size_t i = 0; i < SparseCount; i++) {
+                map.try_emplace(keys[i], i);
+            }
+
+            map.clear();
+        });
+
+        Report("growth", "reserve 8M, insert 1000, clear", sparseSeconds * 1e3, "ms");
+    }
+
+    // A hasher a tenant can defeat: keys sharing their low bits share their hash.
+    struct LowBitsHash {
+        size_t operator()(uint64_t key) const {
+            return static_cast<size_t>(key & 63);
+        }
+    };
+
+    template <class Hasher>
+    void MeasureChains(const std::string &subject, const std::vector<uint64_t> &keys, size_t sortedChainMinLength) {
+        HashMapOptions options;
+        options.sortedChainMinLength = sortedChainMinLength;
+        HashMap<uint64_t, uint64_t, Hasher> map(options);
+        size_t found = 0;
+
+        const auto insertSeconds = MeasureSeconds([&] {
+            for (auto key : keys) {
+                map.try_emplace(key, key);
+            }
+        });
+        const auto findSeconds = MeasureBestSeconds([&] {
+            found = 0;
+
+            for (auto key : keys) {
+                found += map.contains(key + 1) + map.contains(key);
+            }
+        }, 3);
+
+        if (found != keys.size()) {
+            std::abort();
+        }
+
+        Report("adversarial", subject + " insert", keys.size() / insertSeconds / 1e6, "Mops/s");
+        Report("adversarial", subject + " hit and miss", 2 * keys.size() / findSeconds / 1e6, "Mops/s");
+    }
+
+    // 20000 keys falling into 64 buckets, against the same table with plain chains and with sorted ones;
+    // random keys under std::hash show what the guard costs when nothing is wrong.
+    void LongChainsUnderAttack() {
+        auto attack = RandomKeys(20'000, 18);
+        const auto random = RandomKeys(1'000'000, 19);
+
+        for (auto &key : attack) {
+            key = key << 6 | 7;
+        }
+
+        MeasureChains<LowBitsHash>("64 hashes plain chains", attack, SIZE_MAX);
+        MeasureChains<LowBitsHash>("64 hashes sorted chains", attack, 32);
+        MeasureChains<std::hash<uint64_t>>("random keys plain chains", random, SIZE_MAX);
+        MeasureChains<std::hash<uint64_t>>("random keys sorted chains", random, 32);
+    }
+
+    // What every worker process paid before, a private map built from the source data, against opening
+    // the one shared copy; lookups compare a private map with a read only mapping of the segment.
+    void SharedMapAgainstPrivateCopies() {
+        constexpr size_t PairsCount = 1'000'000;
+
+        const auto name = "/hashmap_benchmark_" + std::to_string(getpid());
+        const auto keys = RandomKeys(PairsCount, 20);
+        const auto bytesBefore = LiveBytes();
+        HashMap<uint64_t, uint64_t> copy;
+        size_t found = 0;
+
+        const auto buildSeconds = MeasureSeconds([&] {
+            for (auto key : keys) {
+                copy.try_emplace(key, key);
+            }
+        });
+        const auto copyBytes = LiveBytes() - bytesBefore;
+
+        auto writer = SharedHashMap<uint64_t, uint64_t>::create(name, PairsCount);
+        const auto publishSeconds = MeasureSeconds([&] {
+            for (auto key : keys) {
+                writer.insert_or_assign(key, key);
+            }
+        });
+
+        std::optional<SharedHashMap<uint64_t, uint64_t>> reader;
+        const auto openSeconds = MeasureSeconds([&] {
+            reader.emplace(SharedHashMap<uint64_t, uint64_t>::open(name));
+        });
+
+        const auto copyLookupSeconds = MeasureBestSeconds([&] {
+            for (auto key : keys) {
+                found += copy.contains(key);
+            }
+        }, 3);
+        const auto sharedLookupSeconds = MeasureBestSeconds([&] {
+            for (auto key : keys) {
+                found += reader->get(key).has_value();
+            }
+        }, 3);
+
+        SharedHashMap<uint64_t, uint64_t>::remove(name);
+
+        if (found != PairsCount * 6) {
+            std::abort();
+        }
+
+        Report("shared", "private HashMap build per worker", buildSeconds * 1e3, "ms");
+        Report("shared", "private HashMap memory per worker", static_cast<double>(copyBytes) / 1e6, "MB");
+        Report("shared", "SharedHashMap publish once", publishSeconds * 1e3, "ms");
+        Report("shared", "SharedHashMap open per worker", openSeconds * 1e3, "ms");
+        Report("shared", "SharedHashMap segment per host", reader->capacity() * (sizeof(int32_t) + 32) / 1e6, "MB");
+        Report("shared", "private HashMap lookups", PairsCount / copyLookupSeconds / 1e6, "Mops/s");
+        Report("shared", "SharedHashMap reader lookups", PairsCount / sharedLookupSeconds / 1e6, "Mops/s");
+    }
+
+    // Writes go to the log one sync per group instead of one per update; recovery loads the checkpoint
+    // and replays a tail of updates, against rebuilding from a full dump pair by pair.
+    void DurableLogAgainstFullDumps() {
+        constexpr size_t PairsCount = 1'000'000;
+        constexpr size_t UpdatesCount = 200'000;
+
+        const auto directory = std::filesystem::temp_directory_path() / ("durable_" + std::to_string(getpid()));
+        const auto keys = RandomKeys(PairsCount, 21);
+
+        auto loggedWrites = [&](const char *label, size_t groupCommitRecords, size_t count) {
+            std::filesystem::remove_all(directory);
+            DurabilityOptions options;
+            options.groupCommitRecords = groupCommitRecords;
+            DurableHashMap<uint64_t, uint64_t> map(directory, options);
+
+            const auto seconds = MeasureSeconds([&] {
+                for (size_t i = 0; i < count; i++) {
+                    map.insert_or_assign(keys[i], i);
+                }
+                map.commit();
+            });
+
+            Report("durable", label, static_cast<double>(count) / seconds / 1e3, "Kops/s");
+        };
+
+        loggedWrites("logged writes, sync per update", 1, 2'000);
+        loggedWrites("logged writes, group of 16", 16, 20'000);
+        loggedWrites("logged writes, group of 256", 256, 200'000);
+
+        std::filesystem::remove_all(directory);
+        DurabilityOptions options;
+        options.checkpointLogBytes = SIZE_MAX;
+        std::optional<DurableHashMap<uint64_t, uint64_t>> map(std::in_place, directory, options);
+
+        for (size_t i = 0; i < PairsCount; i++) {
+            map->insert_or_assign(keys[i], i);
+        }
+
+        const auto checkpointSeconds = MeasureSeconds([&] {
+            map->checkpoint();
+        });
+
+        for (size_t i = 0; i < UpdatesCount; i++) {
+            if (i % 4 == 0) {
+                map->erase(keys[i]);
+            } else {
+                map->insert_or_assign(keys[(i * 7) % PairsCount], i);
+            }
+        }
+        map.reset();
+
+        RecoveryStats stats;
+        const auto recoverySeconds = MeasureSeconds([&] {
+            DurableHashMap<uint64_t, uint64_t> recovered(directory, options);
+            stats = recovered.recovery_stats();
+        });
+
+        // The previous scheme: the whole map dumped as pairs and inserted one by one on restart.
+        const auto dumpPath = directory / "dump";
+        HashMap<uint64_t, uint64_t> source;
+        for (size_t i = 0; i < PairsCount; i++) {
+            source[keys[i]] = i;
+        }
+
+        const auto dumpSeconds = MeasureSeconds([&] {
+            std::ofstream out(dumpPath, std::ios::binary);
+            for (const auto &[key, value] : source) {
+                out.write(reinterpret_cast<const char *>(&key), sizeof(key));
+                out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+            }
+        });
+        const auto reloadSeconds = MeasureSeconds([&] {
+            HashMap<uint64_t, uint64_t> reloaded;
+            std::ifstream in(dumpPath, std::ios::binary);
+            uint64_t pair[2];
+            while (in.read(reinterpret_cast<char *>(pair), sizeof(pair))) {
+                reloaded.insert_or_assign(pair[0], pair[1]);
+            }
+        });
+
+        std::filesystem::remove_all(directory);
+
+        if (stats.checkpointPairs != PairsCount || stats.replayedRecords != UpdatesCount) {
+            std::abort();
+        }
+
+        Report("durable", "full dump", dumpSeconds * 1e3, "ms");
+        Report("durable", "checkpoint", checkpointSeconds * 1e3, "ms");
+        Report("durable", "reload full dump pair by pair", reloadSeconds * 1e3, "ms");
+        Report("durable", "recover checkpoint and log tail", recoverySeconds * 1e3, "ms");
+    }
+
+    // Deduplication of a stream whose distinct keys need two and four times the memory budget, against an
+    // unbounded HashMap; distinct keys are counted by visiting the partitions one at a time.
+    void SpillingAgainstUnboundedMap() {
+        constexpr size_t DistinctCount = 2'000'000;
+        constexpr size_t StreamLength = 3'000'000;
+
+        const auto distinct = RandomKeys(DistinctCount, 22);
+        std::vector<uint64_t> stream(StreamLength);
+        std::mt19937_64 random(23);
+
+        for (auto &key : stream) {
+            key = distinct[random() % DistinctCount];
+        }
+
+        HashMap<uint64_t, uint64_t> unbounded;
+        const auto unboundedSeconds = MeasureSeconds([&] {
+            for (auto key : stream) {
+                unbounded.try_emplace(key, key);
+            }
+        });
+        const auto unboundedBytes = unbounded.memory_usage();
+
+        Report("spill", "unbounded HashMap dedup", unboundedSeconds * 1e3, "ms");
+        Report("spill", "unbounded HashMap memory", static_cast<double>(unboundedBytes) / 1e6, "MB");
+
+        for (size_t ratio : {2, 4}) {
+            SpillOptions options;
+            options.memoryBudget = unboundedBytes / ratio;
+            options.partitionsCount = 32;
+            SpillingHashMap<uint64_t, uint64_t> map(options);
+            size_t pairs = 0, peakBytes = 0;
+
+            const auto seconds = MeasureSeconds([&] {
+                for (auto key : stream) {
+                    map.try_emplace(key, key);
+                    peakBytes = std::max(peakBytes, map.memory_usage());
+                }
+
+                map.for_each_partition([&](HashMap<uint64_t, uint64_t> &partition) {
+                    pairs += partition.size();
+                    peakBytes = std::max(peakBytes, map.memory_usage());
+                });
+            });
+
+            if (pairs != unbounded.size()) {
+                std::abort();
+            }
+
+            const auto label = "data " + std::to_string(ratio) + "x budget, ";
+            Report("spill", label + "dedup and merge", seconds * 1e3, "ms");
+            Report("spill", label + "peak resident", static_cast<double>(peakBytes) / 1e6, "MB");
+            Report("spill", label + "written to disk", static_cast<double>(map.spilled_bytes()) / 1e6, "MB");
+        }
+    }
+
+    template <class Action>
+    size_t MeasureBytes(Action action) {
+        const auto before = LiveBytes();
+        action();
+
+        return LiveBytes() - before;
+    }
+
+    void MeasureStringKeys(const char *dataset, const std::vector<std::string> &keys) {
+        std::vector<std::string> lookups(keys);
+        std::shuffle(lookups.begin(), lookups.end(), std::mt19937_64(24));
+        size_t found = 0;
+
+        std::optional<HashMap<std::string, uint32_t, FastHash<std::string>>> strings;
+        const auto stringBytes = MeasureBytes([&] {
+            strings.emplace();
+            for (size_t i = 0; i < keys.size(); i++) {
+                strings->try_emplace(keys[i], static_cast<uint32_t>(i));
+            }
+        });
+        const auto stringSeconds = MeasureBestSeconds([&] {
+            for (const auto &key : lookups) {
+                found += strings->contains(key);
+            }
+        }, 3);
+        strings.reset();
+
+        std::optional<StringKeyMap<uint32_t>> interned;
+        const auto internedBytes = MeasureBytes([&] {
+            interned.emplace();
+            for (size_t i = 0; i < keys.size(); i++) {
+                interned->try_emplace(keys[i], static_cast<uint32_t>(i));
+            }
+        });
+        const auto internedSeconds = MeasureBestSeconds([&] {
+            for (const auto &key : lookups) {
+                found += interned->contains(key);
+            }
+        }, 3);
+
+        if (found != keys.size() * 6) {
+            std::abort();
+        }
+
+        const auto count = static_cast<double>(keys.size());
+        Report("strings", std::string(dataset) + " HashMap<std::string> bytes/key", stringBytes / count, "B");
+        Report("strings", std::string(dataset) + " StringKeyMap bytes/key", internedBytes / count, "B");
+        Report("strings", std::string(dataset) + " HashMap<std::string> lookups", count / stringSeconds / 1e6, "Mops/s");
+        Report("strings", std::string(dataset) + " StringKeyMap lookups", count / internedSeconds / 1e6, "Mops/s");
+    }
+
+    // Keys as separate strings in nodes against keys inline in entries or in one arena.
+    void InternedAgainstStringKeys() {
+        constexpr size_t KeysCount = 1'000'000;
+
+        const auto segments = RandomStrings(KeysCount * 2, 8, 25);
+        const auto hosts = RandomStrings(50, 10, 26);
+        std::vector<std::string> urls, identifiers;
+        std::mt19937_64 random(27);
+
+        for (size_t i = 0; i < KeysCount; i++) {
+            urls.push_back("https://" + hosts[random() % hosts.size()] + ".com/" + segments[2 * i] + "/"
+                           + segments[2 * i + 1] + "?id=" + std::to_string(i));
+            identifiers.push_back(segments[2 * i].substr(0, 3 + random() % 6) + "_" + std::to_string(i));
+        }
+
+        MeasureStringKeys("urls", urls);
+        MeasureStringKeys("identifiers", identifiers);
+    }
+
+    struct Benchmark {
+        const char *name;
+        void (*run)();
+    };
+
+    const Benchmark All[] = {
+        {"set", SetAgainstMapOfBool},
+        {"multimap", MultiMapAgainstMapOfVectors},
+        {"small", SmallMapAgainstHashMap},
+        {"cache", ClockCacheAgainstListLru},
+        {"hugepages", HugePagesAgainstRegularAllocation},
+        {"layout", SplitLayoutAgainstInterleaved},
+        {"snapshot", SnapshotAgainstCopy},
+        {"hash", FastHashAgainstStdHash},
+        {"upsert", WordCountUpserts},
+        {"aggregate", AggregatorScaling},
+        {"join", HashJoinAgainstRowByRow},
+        {"ingest", IngestPipelineAgainstSerialLoad},
+        {"growth", GrowthAndSparseTables},
+        {"adversarial", LongChainsUnderAttack},
+        {"shared", SharedMapAgainstPrivateCopies},
+        {"durable", DurableLogAgainstFullDumps},
+        {"spill", SpillingAgainstUnboundedMap},
+        {"strings", InternedAgainstStringKeys},
+    };
+}
+
+int main(int argc, char **argv) {
+    for (const auto &benchmark : Benchmarks::All) {
+        auto selected = argc == 1;
+
+        for (int i = 1; i < argc; i++) {
+            selected = selected || std::strcmp(argv[i], benchmark.name) == 0;
+        }
+
+        if (selected) {
+            benchmark.run();
+        }
+    }
+
+    return 0;
+}
@@ -146,7 +146,8 @@ namespace coverage {
 
         ASSERT_FALSE(inserted);
         ASSERT_EQ(map[1], 2);
-        ASSERT_EQ(iterator, map.end());
+        ASSERT_EQ(iterator, map.find(1));
+        ASSERT_EQ(2, iterator->second);
     }
 
     TEST(Public, InsertingByRvalueOfValueWillNotCreateCopy) {
@@ -1,3 +1,16 @@
 #pragma once
 
+#include "src/ClockCache.hpp"
+#include "src/DurableHashMap.hpp"
+#include "src/ExpiringHashMap.hpp"
+#include "src/HashJoin.hpp"
 #include "src/HashMap.hpp"
+#include "src/HashMultiMap.hpp"
+#include "src/Hashers.hpp"
+#include "src/IngestPipeline.hpp"
+#include "src/ParallelAggregator.hpp"
+#include "src/HashSet.hpp"
+#include "src/SharedHashMap.hpp"
+#include "src/SnapshotHashMap.hpp"
+#include "src/SpillingHashMap.hpp"
+#include "src/StringKeyMap.hpp"
@@ -1,143 +1,236 @@
-#include "entry_point.h"
-
-#include <string>
-#include <map>
-
-#include "gtest/gtest.h"
-#include "gmock/gmock.h"
-
-using ::testing::UnorderedElementsAre;
-
-namespace Task04 {
-    TEST(Public, IndexOperator) {
-        HashMap<std::string, int> map;
-
-        map["a"] = 1;
-        map["b"] = 2;
-        map["c"] = 3;
-
-        EXPECT_EQ(map["a"], 1);
-        EXPECT_EQ(map["b"], 2);
-        EXPECT_EQ(map["c"], 3);
-
-        map["a"]++;
-        map["b"]++;
-        map["c"]++;
-
-        EXPECT_EQ(map["a"], 2);
-        EXPECT_EQ(map["b"], 3);
-        EXPECT_EQ(map["c"], 4);
-    }
-
-    TEST(Public, Insert) {
-        HashMap<std::string, int> map;
-
-        map.insert(std::pair<std::string, int>("a", 1));
-        map.insert(std::pair<std::string, int>("b", 2));
-        map.insert(std::pair<std::string, int>("c", 3));
-
-        EXPECT_EQ(map["a"], 1);
-        EXPECT_EQ(map["b"], 2);
-        EXPECT_EQ(map["c"], 3);
-    }
-
-    TEST(Public, Iteration) {
-        HashMap<std::string, int> map;
-
-        map.insert(std::pair<std::string, int>("a", 1));
-        map.insert(std::pair<std::string, int>("b", 2));
-        map.insert(std::pair<std::string, int>("c", 3));
-        map.insert(std::pair<std::string, int>("d", 4));
-        map.insert(std::pair<std::string, int>("e", 5));
-
-        std::vector<std::pair<std::string, int>> res;
-        for (auto&& kv : map) {
-            res.emplace_back(kv);
-        }
-
-        EXPECT_THAT(res, UnorderedElementsAre(
-            std::pair<std::string, int>("a", 1),
-            std::pair<std::string, int>("b", 2),
-            std::pair<std::string, int>("c", 3),
-            std::pair<std::string, int>("d", 4),
-            std::pair<std::string, int>("e", 5)
-        ));
-    }
-
-    TEST(Public, Find) {
-        HashMap<std::string, int> map;
-
-        map.insert(std::pair<std::string, int>("a", 1));
-        map.insert(std::pair<std::string, int>("b", 2));
-        map.insert(std::pair<std::string, int>("c", 3));
-        map.insert(std::pair<std::string, int>("d", 4));
-        map.insert(std::pair<std::string, int>("e", 5));
-
-        EXPECT_EQ(map.find("u"), map.end());
-
-        ASSERT_NE(map.find("a"), map.end());
-        EXPECT_EQ(map.find("a")->second, 1);
-
-        ASSERT_NE(map.find("b"), map.end());
-        EXPECT_EQ(map.find("b")->second, 2);
-
-        ASSERT_NE(map.find("c"), map.end());
-        EXPECT_EQ(map.find("c")->second, 3);
-
-        ASSERT_NE(map.find("d"), map.end());
-        EXPECT_EQ(map.find("d")->second, 4);
-
-        ASSERT_NE(map.find("e"), map.end());
-        EXPECT_EQ(map.find("e")->second, 5);
-    }
-
-    TEST(Public, Erase) {
-        HashMap<std::string, int> map;
-
-        map.insert(std::pair<std::string, int>("a", 1));
-        map.insert(std::pair<std::string, int>("b", 2));
-        map.insert(std::pair<std::string, int>("c", 3));
-        map.insert(std::pair<std::string, int>("d", 4));
-        map.insert(std::pair<std::string, int>("e", 5));
-
-        ASSERT_NE(map.find("e"), map.end());
-        map.erase(map.find("e"));
-        EXPECT_EQ(map.find("e"), map.end());
-
-        std::vector<std::pair<std::string, int>> res;
-        for (auto&& kv : map) {
-            res.emplace_back(kv);
-        }
-
-        EXPECT_THAT(res, UnorderedElementsAre(
-            std::pair<std::string, int>("a", 1),
-            std::pair<std::string, int>("b", 2),
-            std::pair<std::string, int>("c", 3),
-            std::pair<std::string, int>("d", 4)
-        ));
-    }
-
-    TEST(Public, InitializerList) {
-        HashMap<std::string, std::string> m = {
-            {"ololo", "ololo1"},
-            {"azaza", "azaza1"},
-            {"ururu", "ururu1"}
-        };
-
-        EXPECT_EQ(m.size(), 3u);
-        ASSERT_NE(m.find("ololo"), m.end());
-        ASSERT_NE(m.find("azaza"), m.end());
-        ASSERT_NE(m.find("ururu"), m.end());
-
-        std::vector<std::pair<std::string, std::string>> res;
-        for (auto&& kv : m) {
-            res.emplace_back(kv);
-        }
-
-        EXPECT_THAT(res, UnorderedElementsAre(
-            std::pair<std::string, std::string>("ololo", "ololo1"),
-            std::pair<std::string, std::string>("azaza", "azaza1"),
-            std::pair<std::string, std::string>("ururu", "ururu1")
-        ));
-    }
-}
+#include "entry_point.h"
+
+#include <initializer_list>
+#include <string>
+#include <map>
+#include <type_traits>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+using ::testing::UnorderedElementsAre;
+
+namespace Task04 {
+    // The map interface these tests use, over a HashSet of pairs hashed and compared by key only,
+    // so the suite checks both containers.
+    template <class TKey, class TValue>
+    class SetAsMap {
+        struct Element {
+            TKey first;
+            mutable TValue second;
+
+            operator std::pair<TKey, TValue>() const {
+                return {first, second};
+            }
+        };
+
+        struct ElementHash {
+            size_t operator()(const Element &element) const {
+                return std::hash<TKey>()(element.first);
+            }
+        };
+
+        struct ElementEqual {
+            bool operator()(const Element &left, const Element &right) const {
+                return left.first == right.first;
+            }
+        };
+
+        HashSet<Element, ElementHash, ElementEqual> set;
+
+    public:
+        SetAsMap() = default;
+
+        SetAsMap(std::initializer_list<std::pair<TKey, TValue>> pairs) {
+            for (const auto &pair : pairs) {
+                insert(pair);
+            }
+        }
+
+        [[nodiscard]] size_t size() const {
+            return set.size();
+        }
+
+        auto begin() {
+            return set.begin();
+        }
+
+        auto end() {
+            return set.end();
+        }
+
+        TValue &operator[](const TKey &key) {
+            return set.insert(Element{key, TValue()}).second->second;
+        }
+
+        void insert(const std::pair<TKey, TValue> &pair) {
+            set.insert(Element{pair.first, pair.second});
+        }
+
+        auto find(const TKey &key) {
+            return set.find(Element{key, TValue()});
+        }
+
+        template <class Iterator>
+        void erase(Iterator position) {
+            set.erase(position);
+        }
+    };
+
+    struct OverHashMap {
+        template <class TKey, class TValue>
+        using Map = HashMap<TKey, TValue>;
+    };
+
+    struct OverHashSet {
+        template <class TKey, class TValue>
+        using Map = SetAsMap<TKey, TValue>;
+    };
+
+    struct ContainerNames {
+        template <class T>
+        static std::string GetName(int) {
+            return std::is_same_v<T, OverHashMap> ? "HashMap" : "HashSet";
+        }
+    };
+
+    template <class Container>
+    class Public : public ::testing::Test {
+    };
+
+    using Containers = ::testing::Types<OverHashMap, OverHashSet>;
+    TYPED_TEST_SUITE(Public, Containers, ContainerNames);
+
+    TYPED_TEST(Public, IndexOperator) {
+        typename TypeParam::template Map<std::string, int> map;
+
+        map["a"] = 1;
+        map["b"] = 2;
+        map["c"] = 3;
+
+        EXPECT_EQ(map["a"], 1);
+        EXPECT_EQ(map["b"], 2);
+        EXPECT_EQ(map["c"], 3);
+
+        map["a"]++;
+        map["b"]++;
+        map["c"]++;
+
+        EXPECT_EQ(map["a"], 2);
+        EXPECT_EQ(map["b"], 3);
+        EXPECT_EQ(map["c"], 4);
+    }
+
+    TYPED_TEST(Public, Insert) {
+        typename TypeParam::template Map<std::string, int> map;
+
+        map.insert(std::pair<std::string, int>("a", 1));
+        map.insert(std::pair<std::string, int>("b", 2));
+        map.insert(std::pair<std::string, int>("c", 3));
+
+        EXPECT_EQ(map["a"], 1);
+        EXPECT_EQ(map["b"], 2);
+        EXPECT_EQ(map["c"], 3);
+    }
+
+    TYPED_TEST(Public, Iteration) {
+        typename TypeParam::template Map<std::string, int> map;
+
+        map.insert(std::pair<std::string, int>("a", 1));
+        map.insert(std::pair<std::string, int>("b", 2));
+        map.insert(std::pair<std::string, int>("c", 3));
+        map.insert(std::pair<std::string, int>("d", 4));
+        map.insert(std::pair<std::string, int>("e", 5));
+
+        std::vector<std::pair<std::string, int>> res;
+        for (auto&& kv : map) {
+            res.emplace_back(kv);
+        }
+
+        EXPECT_THAT(res, UnorderedElementsAre(
+            std::pair<std::string, int>("a", 1),
+            std::pair<std::string, int>("b", 2),
+            std::pair<std::string, int>("c", 3),
+            std::pair<std::string, int>("d", 4),
+            std::pair<std::string, int>("e", 5)
+        ));
+    }
+
+    TYPED_TEST(Public, Find) {
+        typename TypeParam::template Map<std::string, int> map;
+
+        map.insert(std::pair<std::string, int>("a", 1));
+        map.insert(std::pair<std::string, int>("b", 2));
+        map.insert(std::pair<std::string, int>("c", 3));
+        map.insert(std::pair<std::string, int>("d", 4));
+        map.insert(std::pair<std::string, int>("e", 5));
+
+        EXPECT_EQ(map.find("u"), map.end());
+
+        ASSERT_NE(map.find("a"), map.end());
+        EXPECT_EQ(map.find("a")->second, 1);
+
+        ASSERT_NE(map.find("b"), map.end());
+        EXPECT_EQ(map.find("b")->second, 2);
+
+        ASSERT_NE(map.find("c"), map.end());
+        EXPECT_EQ(map.find("c")->second, 3);
+
+        ASSERT_NE(map.find("d"), map.end());
+        EXPECT_EQ(map.find("d")->second, 4);
+
+        ASSERT_NE(map.find("e"), map.end());
+        EXPECT_EQ(map.find("e")->second, 5);
+    }
+
+    TYPED_TEST(Public, Erase) {
+        typename TypeParam::template Map<std::string, int> map;
+
+        map.insert(std::pair<std::string, int>("a", 1));
+        map.insert(std::pair<std::string, int>("b", 2));
+        map.insert(std::pair<std::string, int>("c", 3));
+        map.insert(std::pair<std::string, int>("d", 4));
+        map.insert(std::pair<std::string, int>("e", 5));
+
+        ASSERT_NE(map.find("e"), map.end());
+        map.erase(map.find("e"));
+        EXPECT_EQ(map.find("e"), map.end());
+
+        std::vector<std::pair<std::string, int>> res;
+        for (auto&& kv : map) {
+            res.emplace_back(kv);
+        }
+
+        EXPECT_THAT(res, UnorderedElementsAre(
+            std::pair<std::string, int>("a", 1),
+            std::pair<std::string, int>("b", 2),
+            std::pair<std::string, int>("c", 3),
+            std::pair<std::string, int>("d", 4)
+        ));
+    }
+
+    TYPED_TEST(Public, InitializerList) {
+        typename TypeParam::template Map<std::string, std::string> m = {
+            {"ololo", "ololo1"},
+            {"azaza", "azaza1"},
+            {"ururu", "ururu1"}
+        };
+
+        EXPECT_EQ(m.size(), 3u);
+        ASSERT_NE(m.find("ololo"), m.end());
+        ASSERT_NE(m.find("azaza"), m.end());
+        ASSERT_NE(m.find("ururu"), m.end());
+
+        std::vector<std::pair<std::string, std::string>> res;
+        for (auto&& kv : m) {
+            res.emplace_back(kv);
+        }
+
+        EXPECT_THAT(res, UnorderedElementsAre(
+            std::pair<std::string, std::string>("ololo", "ololo1"),
+            std::pair<std::string, std::string>("azaza", "azaza1"),
+            std::pair<std::string, std::string>("ururu", "ururu1")
+        ));
+    }
+}
@@ -2,11 +2,32 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <tuple>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <set>
+#include <vector>
+
+#if defined(__unix__)
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 
+using ::testing::UnorderedElementsAre;
+
 namespace Task04 {
     TEST(PublicAdvanced, InsertKeyAndVal) {
         HashMap<std::string, int> hm;
@@ -26,4 +47,1422 @@ namespace Task04 {
         ASSERT_EQ(2, std::get<1>(hm["ololo"]));
         ASSERT_FLOAT_EQ(3.14, std::get<2>(hm["ololo"]));
     }
+
+    TEST(PublicAdvanced, ParallelForEachVisitsEveryPair) {
+        HashMap<int, int> hm;
+        for (int i = 0; i < 20000; i++) {
+            hm[i] = i % 7;
+        }
+        hm.erase(hm.find(42));
+
+        std::atomic<long long> sum = 0;
+        std::atomic<int> visited = 0;
+        hm.parallel_for_each([&](auto &kv) {
+            kv.second++;
+            sum += kv.second;
+            visited++;
+        }, 4);
+
+        long long expected = 0;
+        for (const auto &kv : hm) {
+            expected += kv.second;
+        }
+
+        ASSERT_EQ(19999, visited);
+        ASSERT_EQ(expected, sum);
+    }
+
+    TEST(PublicAdvanced, ParallelReduce) {
+        HashMap<int, long long> hm;
+        for (int i = 1; i <= 10000; i++) {
+            hm[i] = i;
+        }
+
+        auto sum = hm.parallel_reduce(100LL, [](const auto &kv) { return kv.second; }, std::plus<>(), 3);
+
+        ASSERT_EQ(100 + 10000LL * 10001 / 2, sum);
+    }
+
+    TEST(PublicAdvanced, ParallelCallbacksRethrowAfterJoining) {
+        HashMap<int, int> hm;
+        for (int i = 0; i < 10000; i++) {
+            hm[i] = i;
+        }
+
+        std::atomic<int> visited = 0;
+        ASSERT_THROW(hm.parallel_for_each([&](auto &kv) {
+            visited++;
+            if (kv.first == 9000) {
+                throw std::runtime_error("callback");
+            }
+        }, 4), std::runtime_error);
+        ASSERT_GT(visited, 0);
+
+        ASSERT_THROW(hm.parallel_reduce(0, [](const auto &kv) {
+            if (kv.first == 0) {
+                throw std::logic_error("map");
+            }
+            return kv.second;
+        }, std::plus<>(), 3), std::logic_error);
+    }
+
+    TEST(PublicAdvanced, PartitionsCoverMapWithoutOverlap) {
+        HashMap<int, int> hm;
+        for (int i = 0; i < 10000; i++) {
+            hm[i] = i;
+        }
+
+        auto partitions = hm.partition(8);
+        ASSERT_GT(partitions.size(), 1u);
+
+        std::map<int, int> seen;
+        for (const auto &partition : partitions) {
+            for (const auto &kv : partition) {
+                seen[kv.first]++;
+            }
+        }
+
+        ASSERT_EQ(10000u, seen.size());
+        for (const auto &[key, times] : seen) {
+            ASSERT_EQ(1, times);
+        }
+    }
+
+    TEST(PublicAdvanced, ParallelResizeKeepsAllPairs) {
+        HashMapOptions options;
+        options.resizeThreadsCount = 4;
+        options.parallelResizeMinCapacity = 0;
+
+        HashMap<int, int> hm(options);
+        for (int i = 0; i < 50000; i++) {
+            hm[i] = -i;
+        }
+        for (int i = 0; i < 50000; i += 3) {
+            hm.erase(hm.find(i));
+        }
+        for (int i = 50000; i < 100000; i++) {
+            hm[i] = -i;
+        }
+
+        ASSERT_EQ(100000u - 16667u, hm.size());
+        for (int i = 0; i < 100000; i++) {
+            auto it = hm.find(i);
+            if (i < 50000 && i % 3 == 0) {
+                ASSERT_EQ(hm.end(), it);
+            } else {
+                ASSERT_NE(hm.end(), it);
+                ASSERT_EQ(-i, it->second);
+            }
+        }
+    }
+
+    TEST(PublicAdvanced, HugePageTableKeepsAllPairs) {
+        HashMapOptions options;
+        options.hugePageMinBytes = 4096;
+        options.numaPolicy = NumaPolicy::Interleave;
+        options.numaNodeMask = 1;
+
+        HashMap<int, std::string> hm(options);
+        for (int i = 0; i < 100000; i++) {
+            hm[i] = std::to_string(i);
+        }
+        for (int i = 0; i < 100000; i += 2) {
+            hm.erase(i);
+        }
+
+        auto copy = hm;
+        auto moved = std::move(hm);
+
+        ASSERT_EQ(50000u, copy.size());
+        ASSERT_EQ(50000u, moved.size());
+        for (int i = 1; i < 100000; i += 2) {
+            ASSERT_EQ(std::to_string(i), copy[i]);
+            ASSERT_EQ(std::to_string(i), moved.find(i)->second);
+        }
+
+        moved.clear();
+        moved[7] = "7";
+        ASSERT_EQ(1u, moved.size());
+    }
+
+    TEST(PublicAdvanced, SplitLayoutKeepsAllPairs) {
+        HashMapOptions options;
+        options.resizeThreadsCount = 3;
+        options.parallelResizeMinCapacity = 1000;
+        options.hugePageMinBytes = 64 * 1024;
+
+        SplitHashMap<int, int> hm(options);
+        for (int i = 0; i < 30000; i++) {
+            hm[i] = -i;
+        }
+        for (int i = 0; i < 30000; i += 4) {
+            hm.erase(i);
+        }
+        for (int i = 30000; i < 60000; i++) {
+            hm[i] = -i;
+        }
+
+        long long sum = 0;
+        for (const auto &[key, value] : hm) {
+            sum += key + value;
+        }
+
+        HashMap<int, int> merged;
+        merged.merge(hm);
+
+        ASSERT_EQ(0, sum);
+        ASSERT_EQ(0u, hm.size());
+        ASSERT_EQ(60000u - 7500u, merged.size());
+        for (int i = 0; i < 60000; i++) {
+            ASSERT_EQ(i >= 30000 || i % 4 != 0, merged.contains(i)) << i;
+        }
+    }
+
+    TEST(PublicAdvanced, GrowthKeepsDeletedSlotsAndClearDestroysLiveNodes) {
+        auto values = std::make_shared<int>(0);
+        SplitHashMap<int, std::shared_ptr<int>> hm;
+        HashMap<int, std::shared_ptr<int>, std::hash<int>, std::equal_to<int>, 8> small;
+
+        for (int i = 0; i < 1000; i++) {
+            hm[i] = values;
+            small[i % 16] = values;
+        }
+        for (int i = 0; i < 1000; i += 2) {
+            hm.erase(i);
+        }
+        small.erase(3);
+        hm.reserve(100000);
+        ASSERT_EQ(1u + 500u + 15u, values.use_count());
+
+        for (int i = 1000; i < 1500; i++) {
+            hm[i] = values;
+        }
+        ASSERT_EQ(1000u, hm.size());
+        ASSERT_GE(hm.bucket_count(), 100000u);
+        ASSERT_FALSE(hm.contains(998));
+        ASSERT_TRUE(hm.contains(1499));
+
+        hm.clear();
+        small.clear();
+        ASSERT_EQ(1, values.use_count());
+    }
+
+    struct FewBucketsHash {
+        size_t operator()(int key) const {
+            return static_cast<size_t>(key % 3);
+        }
+    };
+
+    struct UnorderedKey {
+        int value;
+
+        bool operator==(const UnorderedKey &other) const {
+            return value == other.value;
+        }
+    };
+
+    struct UnorderedKeyHash {
+        size_t operator()(const UnorderedKey &key) const {
+            return static_cast<size_t>(key.value % 2);
+        }
+    };
+
+    TEST(PublicAdvanced, CollidingKeysStaySearchable) {
+        HashMapOptions options;
+        options.sortedChainMinLength = 32;
+        HashMap<int, int, FewBucketsHash> hm(options);
+        HashMap<int, int, FewBucketsHash> plain;
+        for (int i = 0; i < 3000; i++) {
+            hm[i * 7 % 3000] = i;
+            plain[i * 7 % 3000] = i;
+        }
+        ASSERT_EQ(plain.bucket_count(), hm.bucket_count());
+        ASSERT_GT(hm.memory_usage(), plain.memory_usage());
+        for (int i = 0; i < 3000; i += 3) {
+            hm.erase(i);
+        }
+
+        ASSERT_EQ(2000u, hm.size());
+        ASSERT_EQ(1000u, hm.bucket_size(1 % hm.bucket_count()));
+        for (int i = 0; i < 3000; i++) {
+            ASSERT_EQ(i % 3 != 0, hm.contains(i)) << i;
+        }
+
+        std::set<int> seen;
+        for (const auto &[key, value] : hm) {
+            seen.insert(key);
+        }
+        ASSERT_EQ(2000u, seen.size());
+
+        for (auto it = hm.begin(); it != hm.end();) {
+            it = it->first % 2 == 0 ? hm.erase(it) : ++it;
+        }
+        ASSERT_EQ(1000u, hm.size());
+        ASSERT_TRUE(hm.contains(2999));
+        ASSERT_FALSE(hm.contains(2998));
+
+        auto copy = hm;
+        copy[5000] = 1;
+        ASSERT_EQ(1001u, copy.size());
+        ASSERT_TRUE(copy.contains(1));
+
+        HashMap<UnorderedKey, int, UnorderedKeyHash> unordered;
+        for (int i = 0; i < 100; i++) {
+            unordered[UnorderedKey{i}] = i;
+        }
+        unordered.erase(UnorderedKey{42});
+        ASSERT_EQ(99u, unordered.size());
+        ASSERT_EQ(7, unordered[UnorderedKey{7}]);
+    }
+
+    struct CountedKey {
+        static inline int copies = 0;
+
+        int value;
+
+        explicit CountedKey(int value) : value(value) {
+        }
+
+        CountedKey(const CountedKey &other) : value(other.value) {
+            copies++;
+        }
+
+        CountedKey(CountedKey &&other) noexcept = default;
+
+        bool operator==(const CountedKey &other) const {
+            return value == other.value;
+        }
+    };
+
+    struct CountedKeyHash {
+        size_t operator()(const CountedKey &key) const {
+            return static_cast<size_t>(key.value);
+        }
+    };
+
+    TEST(PublicAdvanced, PresentKeysAreNotCopied) {
+        HashMap<CountedKey, int, CountedKeyHash> map;
+        HashSet<CountedKey, CountedKeyHash> set;
+        const CountedKey key(5);
+
+        map[key] = 1;
+        set.insert(key);
+        ASSERT_EQ(2, CountedKey::copies);
+
+        map[key]++;
+        ASSERT_FALSE(set.insert(key).first);
+        ASSERT_EQ(2, CountedKey::copies);
+        ASSERT_EQ(2, map[key]);
+    }
+
+    TEST(PublicAdvanced, TryEmplaceReturnsExistingPair) {
+        HashMap<std::string, int> hm = {{"ololo", 1}};
+
+        auto [inserted, it] = hm.try_emplace("ololo", 2);
+
+        ASSERT_FALSE(inserted);
+        ASSERT_EQ(1, it->second);
+        it->second = 3;
+        ASSERT_EQ(3, hm["ololo"]);
+    }
+
+    TEST(PublicAdvanced, UpsertsTouchValueInPlace) {
+        HashMap<std::string, int> counts;
+
+        for (const auto *word : {"ololo", "azaza", "ololo", "ololo"}) {
+            counts.emplace_or_update(word, [](int &count) { count++; }, 1);
+        }
+
+        ASSERT_EQ(3, counts["ololo"]);
+        ASSERT_EQ(1, counts["azaza"]);
+
+        auto [inserted, it] = counts.insert_or_assign("azaza", 10);
+        ASSERT_FALSE(inserted);
+        ASSERT_EQ(10, it->second);
+        ASSERT_TRUE(counts.insert_or_assign("ururu", 5).first);
+
+        auto computed = counts.compute("new", [](int &count, bool existed) {
+            count += existed ? 100 : 7;
+            return true;
+        });
+        ASSERT_EQ(7, computed->second);
+
+        ASSERT_EQ(counts.end(), counts.compute("ololo", [](int &count, bool) { return --count > 3; }));
+        ASSERT_EQ(counts.end(), counts.find("ololo"));
+        ASSERT_EQ(counts.end(), counts.compute("nope", [](int &, bool) { return false; }));
+        ASSERT_EQ(3u, counts.size());
+    }
+
+    TEST(PublicAdvanced, ExtractAndInsertNodeKeepsPair) {
+        HashMap<std::string, int> from = {{"ololo", 1}, {"azaza", 2}};
+        HashMap<std::string, int> to;
+
+        const auto *address = &*from.find("ololo");
+        auto node = from.extract("ololo");
+
+        ASSERT_FALSE(node.empty());
+        ASSERT_EQ("ololo", node.key());
+        ASSERT_EQ(1, node.mapped());
+        ASSERT_EQ(from.end(), from.find("ololo"));
+        ASSERT_EQ(1u, from.size());
+
+        auto result = to.insert(std::move(node));
+
+        ASSERT_TRUE(result.inserted);
+        ASSERT_TRUE(result.node.empty());
+        ASSERT_EQ(address, &*result.position);
+        ASSERT_EQ(1, to["ololo"]);
+        ASSERT_TRUE(from.extract("ururu").empty());
+    }
+
+    TEST(PublicAdvanced, InsertNodeWithExistingKeyReturnsNodeBack) {
+        HashMap<std::string, int> from = {{"ololo", 1}};
+        HashMap<std::string, int> to = {{"ololo", 2}};
+
+        auto result = to.insert(from.extract(from.find("ololo")));
+
+        ASSERT_FALSE(result.inserted);
+        ASSERT_FALSE(result.node.empty());
+        ASSERT_EQ(1, result.node.mapped());
+        ASSERT_EQ(2, result.position->second);
+    }
+
+    TEST(PublicAdvanced, MergeMovesOnlyAbsentKeys) {
+        HashMap<int, int> to = {{1, 10}, {2, 20}};
+        HashMap<int, int> from;
+        for (int i = 0; i < 1000; i++) {
+            from[i] = -i;
+        }
+
+        to.merge(from);
+
+        ASSERT_EQ(1000u, to.size());
+        ASSERT_EQ(10, to[1]);
+        ASSERT_EQ(20, to[2]);
+        ASSERT_EQ(-500, to[500]);
+        EXPECT_THAT(from, UnorderedElementsAre(std::make_pair(1, -1), std::make_pair(2, -2)));
+    }
+
+    TEST(PublicMultiMap, KeepsValuesOfKeyInInsertionOrder) {
+        HashMultiMap<std::string, int> mm;
+        for (int i = 0; i < 20; i++) {
+            mm.insert("ololo", i);
+            mm.insert(i % 2 == 0 ? "azaza" : "ururu", -i);
+        }
+
+        ASSERT_EQ(40u, mm.size());
+        ASSERT_EQ(3u, mm.keys_count());
+        ASSERT_EQ(20u, mm.count("ololo"));
+        ASSERT_EQ(10u, mm.count("azaza"));
+        ASSERT_EQ(0u, mm.count("nope"));
+
+        std::vector<int> values(mm.values("ololo").begin(), mm.values("ololo").end());
+        std::vector<int> expected(20);
+        std::iota(expected.begin(), expected.end(), 0);
+        ASSERT_EQ(expected, values);
+
+        auto [first, last] = mm.equal_range("ururu");
+        ASSERT_EQ(10, std::distance(first, last));
+        ASSERT_EQ(-1, *first);
+
+        auto [missingFirst, missingLast] = mm.equal_range("nope");
+        ASSERT_EQ(missingFirst, missingLast);
+    }
+
+    TEST(PublicMultiMap, EraseReusesChunks) {
+        HashMultiMap<int, std::string, std::hash<int>, std::equal_to<int>, 4> mm;
+        for (int i = 0; i < 10; i++) {
+            mm.insert(1, std::to_string(i));
+        }
+
+        ASSERT_EQ(10u, mm.erase(1));
+        ASSERT_EQ(0u, mm.erase(1));
+        ASSERT_EQ(0u, mm.size());
+        ASSERT_FALSE(mm.contains(1));
+
+        mm.insert(2, "a");
+        mm.insert(2, "b");
+
+        HashMultiMap<int, std::string, std::hash<int>, std::equal_to<int>, 4> copy = mm;
+        mm.insert(2, "c");
+
+        std::vector<std::string> copied(copy.values(2).begin(), copy.values(2).end());
+        ASSERT_THAT(copied, ::testing::ElementsAre("a", "b"));
+        ASSERT_EQ(3u, mm.count(2));
+    }
+
+    TEST(PublicMultiMap, ThrowingValueLeavesNoEmptyChunkOrGroup) {
+        struct Checked {
+            int value;
+
+            explicit Checked(int value) : value(value) {
+                if (value < 0) {
+                    throw std::invalid_argument("negative");
+                }
+            }
+        };
+
+        HashMultiMap<int, Checked, std::hash<int>, std::equal_to<int>, 2> mm;
+        mm.emplace(1, 0);
+        mm.emplace(1, 1);
+        ASSERT_THROW(mm.emplace(1, -1), std::invalid_argument);
+        ASSERT_THROW(mm.emplace(2, -1), std::invalid_argument);
+        ASSERT_FALSE(mm.contains(2));
+        ASSERT_EQ(2u, mm.size());
+
+        mm.emplace(1, 2);
+        std::vector<int> values;
+        for (const auto &checked : mm.values(1)) {
+            values.push_back(checked.value);
+        }
+        ASSERT_THAT(values, ::testing::ElementsAre(0, 1, 2));
+    }
+
+    TEST(PublicMultiMap, ForEachKeyVisitsAllGroups) {
+        HashMultiMap<int, int> mm;
+        for (int i = 0; i < 100; i++) {
+            mm.insert(i % 10, i);
+        }
+
+        std::map<int, int> sums;
+        mm.for_each_key([&](int key, const auto &values) {
+            for (auto value : values) {
+                sums[key] += value;
+            }
+        });
+
+        ASSERT_EQ(10u, sums.size());
+        ASSERT_EQ(450, sums[0]);
+        ASSERT_EQ(540, sums[9]);
+    }
+
+    TEST(PublicSmallMap, KeepsPairsInlineUntilItGrows) {
+        SmallHashMap<std::string, int, 4> hm;
+
+        hm["a"] = 1;
+        hm["b"] = 2;
+        hm.insert("c", 3);
+        hm.try_emplace("d", 4);
+
+        const auto *inlinePair = &*hm.find("a");
+        ASSERT_GE(reinterpret_cast<const char *>(inlinePair), reinterpret_cast<const char *>(&hm));
+        ASSERT_LT(reinterpret_cast<const char *>(inlinePair), reinterpret_cast<const char *>(&hm + 1));
+
+        hm.erase(hm.find("b"));
+        hm["e"] = 5;
+        hm["f"] = 6;
+        for (int i = 0; i < 100; i++) {
+            hm[std::to_string(i)] = i;
+        }
+
+        ASSERT_EQ(105u, hm.size());
+        ASSERT_EQ(1, hm["a"]);
+        ASSERT_EQ(hm.end(), hm.find("b"));
+        ASSERT_EQ(6, hm["f"]);
+        ASSERT_EQ(99, hm["99"]);
+    }
+
+    TEST(PublicSmallMap, CopyMoveAndNodesOfInlineMap) {
+        static_assert(std::is_nothrow_move_constructible_v<HashMap<std::string, int>>);
+        static_assert(std::is_nothrow_move_constructible_v<SmallHashMap<int, int, 4>>);
+        static_assert(!std::is_nothrow_move_constructible_v<SmallHashMap<std::string, int, 4>>);
+
+        SmallHashMap<std::string, std::string> hm = {{"ololo", "1"}, {"azaza", "2"}};
+
+        auto copy = hm;
+        auto moved = std::move(hm);
+        auto node = moved.extract("ololo");
+        copy.insert(std::move(node));
+
+        HashMap<std::string, std::string> big;
+        big.merge(copy);
+
+        EXPECT_THAT(moved, UnorderedElementsAre(std::make_pair("azaza", "2")));
+        EXPECT_THAT(big, UnorderedElementsAre(std::make_pair("ololo", "1"), std::make_pair("azaza", "2")));
+        EXPECT_EQ(0u, hm.size());
+        EXPECT_EQ(0u, copy.size());
+    }
+
+    // Copies throw once `copiesLeft` runs out; the move may throw too, so growing copies nodes.
+    struct FragileValue {
+        static inline int copiesLeft = -1;
+        static inline int alive = 0;
+
+        int value;
+
+        explicit FragileValue(int value) : value(value) {
+            alive++;
+        }
+
+        FragileValue(const FragileValue &other) : value(other.value) {
+            if (copiesLeft == 0) {
+                throw std::runtime_error("copy");
+            }
+
+            copiesLeft--;
+            alive++;
+        }
+
+        FragileValue(FragileValue &&other) : value(other.value) {
+            alive++;
+        }
+
+        ~FragileValue() {
+            alive--;
+        }
+    };
+
+    TEST(PublicSmallMap, FailedSpillToHeapKeepsInlinePairs) {
+        {
+            SmallHashMap<int, FragileValue, 4> map;
+            for (int i = 0; i < 4; i++) {
+                map.try_emplace(i, i * 10);
+            }
+
+            FragileValue::copiesLeft = 2;
+            ASSERT_THROW(map.try_emplace(4, 40), std::runtime_error);
+            FragileValue::copiesLeft = -1;
+
+            ASSERT_EQ(4u, map.size());
+            ASSERT_EQ(4, FragileValue::alive);
+            for (int i = 0; i < 4; i++) {
+                ASSERT_EQ(i * 10, map.find(i)->second.value);
+            }
+
+            map.try_emplace(4, 40);
+            ASSERT_EQ(40, map.find(4)->second.value);
+            ASSERT_EQ(5, FragileValue::alive);
+        }
+        ASSERT_EQ(0, FragileValue::alive);
+    }
+
+    TEST(PublicSmallMap, FailedNodeTransfersLeaveNodesWhereTheyWere) {
+        {
+            SmallHashMap<int, FragileValue, 4> small;
+            SmallHashMap<int, FragileValue, 4> grown;
+            HashMap<int, FragileValue> big;
+            small.try_emplace(0, 0);
+            small.try_emplace(1, 10);
+            for (int i = 10; i < 15; i++) {
+                grown.try_emplace(i, i);
+            }
+            big.try_emplace(2, 20);
+            big.try_emplace(3, 30);
+
+            // Nodes enter and leave inline storage by copies, the move of FragileValue may throw.
+            FragileValue::copiesLeft = 0;
+            auto node = grown.extract(10);
+            ASSERT_THROW(small.insert(std::move(node)), std::runtime_error);
+            ASSERT_FALSE(node.empty());
+            ASSERT_EQ(10, node.mapped().value);
+            ASSERT_THROW(small.extract(1), std::runtime_error);
+            ASSERT_EQ(10, small.find(1)->second.value);
+
+            FragileValue::copiesLeft = 1;
+            ASSERT_THROW(small.merge(big), std::runtime_error);
+            FragileValue::copiesLeft = -1;
+
+            ASSERT_EQ(3u, small.size());
+            ASSERT_EQ(1u, big.size());
+            ASSERT_EQ(2, small.contains(2) + small.contains(3) + big.contains(2) + big.contains(3));
+            ASSERT_TRUE(small.insert(std::move(node)).inserted);
+            ASSERT_EQ(10, small.find(10)->second.value);
+            ASSERT_EQ(9, FragileValue::alive);
+        }
+        ASSERT_EQ(0, FragileValue::alive);
+    }
+
+    TEST(PublicClockCache, EvictsUnreferencedEntriesFirst) {
+        ClockCache<int, std::string> cache(3);
+
+        cache.put(1, "1");
+        cache.put(2, "2");
+        cache.put(3, "3");
+
+        ASSERT_NE(nullptr, cache.get(1));
+        ASSERT_NE(nullptr, cache.get(3));
+
+        cache.put(4, "4");
+
+        ASSERT_EQ(3u, cache.size());
+        ASSERT_EQ(1u, cache.evictions());
+        ASSERT_FALSE(cache.contains(2));
+        ASSERT_EQ("1", *cache.get(1));
+        ASSERT_EQ("4", *cache.get(4));
+        ASSERT_EQ(nullptr, cache.get(2));
+        ASSERT_EQ(4u, cache.hits());
+        ASSERT_EQ(1u, cache.misses());
+    }
+
+    TEST(PublicClockCache, GetOrLoadCallsLoaderOnlyOnMiss) {
+        ClockCache<int, int> cache(100);
+        int loads = 0;
+        auto loader = [&](int key) {
+            loads++;
+            return key * key;
+        };
+
+        for (int round = 0; round < 3; round++) {
+            for (int i = 0; i < 100; i++) {
+                ASSERT_EQ(i * i, cache.get_or_load(i, loader));
+            }
+        }
+
+        ASSERT_EQ(100, loads);
+        ASSERT_EQ(200u, cache.hits());
+        ASSERT_EQ(100u, cache.misses());
+
+        for (int i = 100; i < 1000; i++) {
+            cache.get_or_load(i, loader);
+        }
+
+        ASSERT_EQ(100u, cache.size());
+        ASSERT_EQ(900u, cache.evictions());
+    }
+
+    struct ManualClock {
+        using duration = std::chrono::milliseconds;
+        using time_point = std::chrono::time_point<std::chrono::steady_clock, duration>;
+
+        const duration *current;
+
+        time_point now() const {
+            return time_point(*current);
+        }
+    };
+
+    TEST(PublicExpiringMap, ExpiredPairsAreMissing) {
+        std::chrono::milliseconds now(1000);
+        ExpiringHashMap<std::string, int, ManualClock> sessions(std::chrono::milliseconds(1), ManualClock{&now});
+
+        sessions.put("ololo", 1, std::chrono::milliseconds(100));
+        sessions.put("azaza", 2, std::chrono::milliseconds(300));
+
+        now += std::chrono::milliseconds(99);
+        ASSERT_NE(nullptr, sessions.get("ololo"));
+
+        now += std::chrono::milliseconds(1);
+        ASSERT_EQ(nullptr, sessions.get("ololo"));
+        ASSERT_FALSE(sessions.contains("ololo"));
+        ASSERT_EQ(2, *sessions.get("azaza"));
+
+        sessions.put("azaza", 3, std::chrono::milliseconds(300));
+        now += std::chrono::milliseconds(250);
+        ASSERT_EQ(3, *sessions.get("azaza"));
+        ASSERT_EQ(1u, sessions.size());
+    }
+
+    TEST(PublicExpiringMap, ExpireRemovesOnlyDuePairs) {
+        std::chrono::milliseconds now(0);
+        ExpiringHashMap<int, int, ManualClock> sessions(std::chrono::milliseconds(1), ManualClock{&now});
+
+        // Spread deadlines over every wheel level and beyond.
+        for (int i = 0; i < 2000; i++) {
+            sessions.put(i, i, std::chrono::milliseconds(1 + static_cast<long long>(i) * i * 37));
+        }
+        sessions.erase(5);
+
+        std::chrono::milliseconds deadlines[] = {
+            std::chrono::milliseconds(50), std::chrono::milliseconds(5000),
+            std::chrono::milliseconds(300000), std::chrono::milliseconds(40000000),
+            std::chrono::milliseconds(200000000)
+        };
+
+        size_t removed = 0;
+        for (auto deadline : deadlines) {
+            now = deadline;
+            removed += sessions.expire();
+
+            size_t alive = 0;
+            for (int i = 0; i < 2000; i++) {
+                const auto expected = i != 5 && 1 + static_cast<long long>(i) * i * 37 > deadline.count();
+                ASSERT_EQ(expected, sessions.get(i) != nullptr) << i << " at " << deadline.count();
+                alive += expected;
+            }
+
+            ASSERT_EQ(alive, sessions.size());
+            ASSERT_EQ(1999u - alive, removed);
+        }
+
+        ASSERT_EQ(0u, sessions.size());
+    }
+
+    TEST(PublicSnapshotMap, SnapshotIgnoresLaterUpdates) {
+        SnapshotHashMap<std::string, int> config;
+        config.insert_or_assign("ololo", 1);
+        config.insert_or_assign("azaza", 2);
+
+        auto view = config.snapshot();
+
+        ASSERT_FALSE(config.insert_or_assign("ololo", 10));
+        ASSERT_TRUE(config.insert_or_assign("ururu", 3));
+        ASSERT_EQ(1u, config.erase("azaza"));
+        ASSERT_EQ(0u, config.erase("azaza"));
+
+        ASSERT_EQ(2u, view.size());
+        ASSERT_EQ(1, *view.get("ololo"));
+        ASSERT_EQ(2, *view.get("azaza"));
+        ASSERT_FALSE(view.contains("ururu"));
+
+        ASSERT_EQ(2u, config.size());
+        ASSERT_EQ(10, *config.get("ololo"));
+        ASSERT_EQ(nullptr, config.get("azaza"));
+        ASSERT_EQ(3, *config.snapshot().get("ururu"));
+    }
+
+    TEST(PublicSnapshotMap, UpdatesCopyOnlyTouchedPages) {
+        SnapshotHashMap<int, int> config;
+        for (int i = 0; i < 100000; i++) {
+            config.insert_or_assign(i, i);
+        }
+        ASSERT_EQ(0u, config.copied_pages());
+
+        auto view = config.snapshot();
+
+        config.insert_or_assign(42, -42);
+        ASSERT_EQ(1u, config.copied_pages());
+        config.insert_or_assign(42, 42);
+        ASSERT_EQ(1u, config.copied_pages());
+
+        config.erase(7);
+        ASSERT_LE(config.copied_pages(), 3u);
+
+        long long sum = 0;
+        view.for_each([&sum](const auto &kv) {
+            sum += kv.second;
+        });
+
+        ASSERT_EQ(100000LL * 99999 / 2, sum);
+        ASSERT_EQ(7, *view.get(7));
+        ASSERT_FALSE(config.contains(7));
+    }
+
+    TEST(PublicHashers, EqualBytesHashEqually) {
+        const std::string text(300, 'x');
+        std::set<size_t> hashes;
+
+        for (size_t length = 0; length <= text.size(); length++) {
+            const auto prefix = text.substr(0, length);
+
+            ASSERT_EQ(FastHash<std::string>()(prefix), FastHash<std::string_view>()(prefix));
+            hashes.insert(FastHash<std::string>()(prefix));
+        }
+
+        ASSERT_EQ(text.size() + 1, hashes.size());
+        ASSERT_NE(FastHash<std::string>(1)("ololo"), FastHash<std::string>(2)("ololo"));
+        ASSERT_EQ(FastHash<std::vector<int>>()({1, 2, 3}), FastHash<std::vector<int>>()({1, 2, 3}));
+        ASSERT_NE(FastHash<std::vector<int>>()({1, 2, 3}), FastHash<std::vector<int>>()({1, 2, 4}));
+    }
+
+    TEST(PublicHashers, IntegerKeysSpreadOverBuckets) {
+        HashMap<uint64_t, int, FastHash<uint64_t>> hm;
+        for (uint64_t i = 0; i < 10000; i++) {
+            hm[i << 40] = 1;
+        }
+
+        size_t total = 0;
+        size_t longest = 0;
+        for (size_t bucket = 0; bucket < hm.bucket_count(); bucket++) {
+            total += hm.bucket_size(bucket);
+            longest = std::max(longest, hm.bucket_size(bucket));
+        }
+
+        ASSERT_EQ(hm.size(), total);
+        ASSERT_LE(longest, 8u);
+    }
+
+    TEST(PublicAggregator, MatchesSequentialGroupBy) {
+        std::vector<std::pair<int, long long>> rows;
+        for (int i = 0; i < 50000; i++) {
+            rows.emplace_back(i * 7919 % 1000, i);
+        }
+
+        ParallelAggregator<int, long long> aggregator(3);
+        aggregator.consume(rows);
+        aggregator.consume(std::vector<std::pair<int, long long>>{{5, 1}, {100000, 2}});
+
+        std::map<int, long long> expected;
+        for (const auto &[key, value] : rows) {
+            expected[key] += value;
+        }
+        expected[5] += 1;
+        expected[100000] += 2;
+
+        auto partitions = aggregator.finalize();
+        ASSERT_EQ(4u, partitions.size());
+
+        std::map<int, long long> actual;
+        for (auto &partition : partitions) {
+            for (const auto &[key, value] : partition) {
+                ASSERT_TRUE(actual.emplace(key, value).second) << key;
+            }
+        }
+
+        ASSERT_EQ(expected, actual);
+        ASSERT_EQ(0u, aggregator.finalize()[0].size());
+    }
+
+    TEST(PublicAggregator, UsesCombiner) {
+        auto maximum = [](int a, int b) { return std::max(a, b); };
+        ParallelAggregator<std::string, int, decltype(maximum)> aggregator(2, maximum);
+
+        aggregator.consume(std::vector<std::pair<std::string, int>>{{"ololo", 3}, {"azaza", 1}, {"ololo", 7}, {"ololo", 5}});
+
+        auto partitions = aggregator.finalize();
+        HashMap<std::string, int> merged;
+        for (auto &partition : partitions) {
+            merged.merge(partition);
+        }
+
+        ASSERT_EQ(7, merged["ololo"]);
+        ASSERT_EQ(1, merged["azaza"]);
+    }
+
+    struct CountingHash {
+        static inline std::atomic<int> calls = 0;
+
+        size_t operator()(int key) const {
+            calls++;
+            return std::hash<int>()(key);
+        }
+    };
+
+    TEST(PublicAggregator, HashesEveryRowOnce) {
+        std::vector<std::pair<int, int>> rows;
+        for (int i = 0; i < 1000; i++) {
+            rows.emplace_back(i % 10, 1);
+        }
+
+        for (size_t threads : {1, 3}) {
+            ParallelAggregator<int, int, std::plus<int>, CountingHash> aggregator(threads);
+            CountingHash::calls = 0;
+            aggregator.consume(rows);
+            ASSERT_EQ(1000, CountingHash::calls);
+
+            auto partitions = aggregator.finalize();
+            HashMap<int, int, CountingHash> merged;
+            for (auto &partition : partitions) {
+                merged.merge(partition);
+            }
+            ASSERT_EQ(100, merged[7]);
+        }
+    }
+
+    TEST(PublicHashJoin, InnerJoinKeepsDuplicatesOnBothSides) {
+        const std::vector<std::string> build = {"a", "b", "a", "c", "a"};
+        const std::vector<std::string> probe = {"x", "a", "c", "a"};
+
+        HashJoin<std::string> join;
+        join.build(build);
+
+        JoinOutput output;
+        ASSERT_EQ(7u, join.probe(probe, JoinKind::Inner, output));
+        ASSERT_EQ(3u, join.distinct_keys());
+
+        std::vector<std::pair<size_t, size_t>> pairs;
+        for (size_t i = 0; i < output.probeIndices.size(); i++) {
+            pairs.emplace_back(output.buildIndices[i], output.probeIndices[i]);
+        }
+
+        const std::vector<std::pair<size_t, size_t>> expected = {
+            {0, 1}, {2, 1}, {4, 1}, {3, 2}, {0, 3}, {2, 3}, {4, 3}
+        };
+        ASSERT_EQ(expected, pairs);
+    }
+
+    TEST(PublicHashJoin, SemiAndAntiJoinsSplitProbeRows) {
+        std::vector<int> build, probe;
+        for (int i = 0; i < 1000; i++) {
+            build.push_back(i * 3);
+            build.push_back(i * 3);
+        }
+        for (int i = 0; i < 3000; i++) {
+            probe.push_back(i);
+        }
+
+        HashJoin<int> join;
+        join.build(build);
+
+        JoinOutput semi, anti;
+        join.probe(probe, JoinKind::Semi, semi);
+        join.probe(probe, JoinKind::Anti, anti);
+
+        ASSERT_EQ(1000u, semi.probeIndices.size());
+        ASSERT_EQ(2000u, anti.probeIndices.size());
+        ASSERT_TRUE(semi.buildIndices.empty());
+        for (auto row : semi.probeIndices) {
+            ASSERT_EQ(0, probe[row] % 3);
+        }
+        for (auto row : anti.probeIndices) {
+            ASSERT_NE(0, probe[row] % 3);
+        }
+
+        join.build(std::vector<int>());
+        anti.clear();
+        ASSERT_EQ(3000u, join.probe(probe, JoinKind::Anti, anti));
+    }
+
+    TEST(PublicIngest, CsvChunksKeepFirstOccurrence) {
+        const auto path = testing::TempDir() + "ingest.csv";
+        {
+            std::ofstream out(path, std::ios::binary);
+            for (int i = 0; i < 5000; i++) {
+                out << "key" << i << ",value" << i << (i % 2 == 0 ? "\r\n" : "\n");
+            }
+            out << "\nkey7,duplicate\n";
+        }
+
+        HashMap<std::string, std::string> map;
+        IngestOptions options;
+        options.threadsCount = 3;
+        options.pipelineDepth = 2;
+        options.chunkBytes = 1000;
+
+        const auto stats = IngestFile(path, IngestFormat::Csv, map, options);
+        std::remove(path.c_str());
+
+        ASSERT_GT(stats.chunks, 10u);
+        ASSERT_EQ(5001u, stats.records);
+        ASSERT_EQ(5000u, stats.inserted);
+        ASSERT_EQ(5000u, map.size());
+        ASSERT_EQ("value7", map["key7"]);
+        ASSERT_EQ("value4999", map["key4999"]);
+    }
+
+    TEST(PublicIngest, LengthPrefixedRecordsAndErrors) {
+        const auto path = testing::TempDir() + "ingest.bin";
+        auto writeField = [](std::ofstream &out, const std::string &field) {
+            const auto length = static_cast<uint32_t>(field.size());
+            out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+            out.write(field.data(), static_cast<std::streamsize>(field.size()));
+        };
+        {
+            std::ofstream out(path, std::ios::binary);
+            for (int i = 0; i < 3000; i++) {
+                writeField(out, std::to_string(i));
+                writeField(out, std::string(i % 7, 'x') + ",\n");
+            }
+        }
+
+        HashMap<std::string, std::string> map;
+        map.insert("5", "kept");
+        IngestOptions options;
+        options.threadsCount = 2;
+        options.chunkBytes = 512;
+
+        const auto stats = IngestFile(path, IngestFormat::LengthPrefixed, map, options);
+
+        ASSERT_EQ(3000u, stats.records);
+        ASSERT_EQ(2999u, stats.inserted);
+        ASSERT_EQ(3000u, map.size());
+        ASSERT_EQ("kept", map["5"]);
+        ASSERT_EQ("xxxxx,\n", map["2994"]);
+
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::app);
+            writeField(out, "truncated");
+            out.write("\7\0", 2);
+        }
+        ASSERT_THROW(IngestFile(path, IngestFormat::LengthPrefixed, map, options), std::runtime_error);
+        ASSERT_THROW(IngestFile(path + ".missing", IngestFormat::Csv, map, options), std::runtime_error);
+        std::remove(path.c_str());
+    }
+
+    TEST(PublicIngest, BulkInsertAfterReserveKeepsDeletedSlots) {
+        HashMap<int, int> map;
+        for (int i = 0; i < 100; i++) {
+            map[i] = i;
+        }
+        for (int i = 0; i < 100; i += 2) {
+            map.erase(i);
+        }
+        map.reserve(10000);
+        ASSERT_GE(map.bucket_count(), 10000u);
+
+        std::vector<std::pair<int, int>> items;
+        std::vector<size_t> hashes;
+        for (int i = 0; i < 20000; i++) {
+            items.emplace_back(i % 10000, -i);
+            hashes.push_back(map.hash_function()(i % 10000));
+        }
+
+        ASSERT_EQ(9950u, map.insert_bulk(std::move(items), hashes));
+        ASSERT_EQ(10000u, map.size());
+        ASSERT_EQ(1, map[1]);
+        ASSERT_EQ(0, map[0]);
+        ASSERT_EQ(-9998, map[9998]);
+    }
+
+    TEST(PublicSpillingMap, SpilledWritesApplyInOrderWhenLoaded) {
+        SpillOptions options;
+        options.memoryBudget = 64 << 10;
+        options.partitionsCount = 8;
+        options.writeBufferBytes = 1 << 10;
+        options.directory = testing::TempDir();
+        SpillingHashMap<std::string, int> map(options);
+
+        for (int i = 0; i < 5000; i++) {
+            map.insert("key" + std::to_string(i), i);
+        }
+        ASSERT_GT(map.spilled_partitions(), 0u);
+        ASSERT_LT(map.resident_size(), 5000u);
+        ASSERT_GT(map.spilled_bytes(), 0u);
+
+        for (int i = 0; i < 5000; i++) {
+            map.insert("key" + std::to_string(i), -i);
+        }
+        for (int i = 0; i < 5000; i += 10) {
+            map.insert_or_assign("key" + std::to_string(i), -1);
+        }
+        for (int i = 5; i < 5000; i += 10) {
+            map.erase("key" + std::to_string(i));
+        }
+        map.insert_or_assign(std::string(100, 'x'), 7);
+
+        ASSERT_EQ(7, *map.find(std::string(100, 'x')));
+        ASSERT_EQ(-1, *map.find("key20"));
+        ASSERT_EQ(21, *map.find("key21"));
+        ASSERT_FALSE(map.contains("key25"));
+
+        size_t pairs = 0;
+        size_t largestPartition = 0;
+        map.for_each_partition([&](HashMap<std::string, int> &partition) {
+            for (const auto &[key, value] : partition) {
+                const auto i = key.size() == 100 ? -7 : std::stoi(key.substr(3));
+                ASSERT_EQ(i == -7 ? 7 : i % 10 == 0 ? -1 : i, value);
+                ASSERT_NE(5, i % 10);
+            }
+            pairs += partition.size();
+            largestPartition = std::max(largestPartition, partition.memory_usage());
+            ASSERT_LE(map.memory_usage(), options.memoryBudget + 2 * largestPartition);
+        });
+        ASSERT_EQ(4501u, pairs);
+    }
+
+    TEST(PublicSpillingMap, BufferedWritesAreFlushedBeforeResidentPartitionsSpill) {
+        SpillOptions options;
+        options.memoryBudget = 64 << 10;
+        options.partitionsCount = 64;
+        options.writeBufferBytes = 1 << 20;
+        options.directory = testing::TempDir();
+        SpillingHashMap<std::string, int> map(options);
+
+        size_t peak = 0;
+        for (int i = 0; i < 20000; i++) {
+            map.insert("key" + std::to_string(i), i);
+            peak = std::max(peak, map.memory_usage());
+        }
+        ASSERT_LE(peak, 2 * options.memoryBudget);
+        ASSERT_LT(map.spilled_partitions(), options.partitionsCount);
+        ASSERT_EQ(12345, *map.find("key12345"));
+    }
+
+    TEST(PublicSpillingMap, FailedLoadKeepsPartitionSpilled) {
+        SpillOptions options;
+        options.memoryBudget = 16 << 10;
+        options.partitionsCount = 4;
+        options.writeBufferBytes = 0;
+        options.directory = testing::TempDir() + "spill_load_" + std::to_string(getpid());
+        std::filesystem::remove_all(options.directory);
+        SpillingHashMap<std::string, int> map(options);
+
+        for (int i = 0; i < 2000; i++) {
+            map.insert("key" + std::to_string(i), i);
+        }
+        size_t spilled = 0;
+        while (!map.is_spilled(spilled)) {
+            spilled++;
+        }
+        int i = 0;
+        while (map.partition_of("key" + std::to_string(i)) != spilled) {
+            i++;
+        }
+        const auto key = "key" + std::to_string(i);
+
+        const auto file = std::filesystem::directory_iterator(options.directory)->path()
+                          / ("partition-" + std::to_string(spilled));
+        const auto size = std::filesystem::file_size(file);
+        std::ofstream(file, std::ios::binary | std::ios::app).put('\1');
+
+        ASSERT_THROW(map.find(key), std::runtime_error);
+        ASSERT_TRUE(map.is_spilled(spilled));
+        ASSERT_EQ(size + 1, std::filesystem::file_size(file));
+
+        std::filesystem::resize_file(file, size);
+        ASSERT_EQ(i, *map.find(key));
+        ASSERT_FALSE(map.is_spilled(spilled));
+        ASSERT_FALSE(std::filesystem::exists(file));
+        std::filesystem::remove_all(options.directory);
+    }
+
+    TEST(PublicStringKeyMap, ShortAndLongKeysAndArenaCompaction) {
+        StringKeyMap<int> map;
+        std::vector<std::string> keys;
+        for (int i = 0; i < 3000; i++) {
+            keys.push_back(i % 2 == 0 ? "id" + std::to_string(i) : "https://example.com/items/" + std::to_string(i));
+        }
+        for (int i = 0; i < 3000; i++) {
+            ASSERT_TRUE(map.insert(keys[i], i));
+        }
+        ASSERT_FALSE(map.insert(keys[7], -7));
+        ASSERT_EQ(3000u, map.size());
+
+        const auto longKeyBytes = map.arena_bytes();
+        ASSERT_GT(longKeyBytes, 1500u * StringKeyMap<int>::InlineKeyLength);
+
+        // Keys sharing their first bytes and differing only past them.
+        ASSERT_EQ(nullptr, map.find("https://example.com/items/99999"));
+        ASSERT_EQ(7, *map.find(std::string_view(keys[7])));
+        ASSERT_EQ(8, *map.find("id8"));
+
+        for (int i = 0; i < 3000; i += 3) {
+            ASSERT_EQ(1u, map.erase(keys[i]));
+        }
+        ASSERT_EQ(0u, map.erase(keys[0]));
+        ASSERT_EQ(2000u, map.size());
+        ASSERT_EQ(longKeyBytes, map.arena_bytes());
+
+        map["id1"] = 11;
+        map.shrink_to_fit();
+        ASSERT_LT(map.arena_bytes(), longKeyBytes);
+
+        size_t visited = 0;
+        map.for_each([&](std::string_view key, int &value) {
+            ASSERT_TRUE(key == "id1" ? value == 11 : keys[value] == key);
+            visited++;
+        });
+        ASSERT_EQ(2001u, visited);
+        for (int i = 1; i < 3000; i++) {
+            ASSERT_EQ(i % 3 != 0, map.contains(keys[i]));
+        }
+
+        // A key viewing part of a stored one, inserted just as the table grows and compacts the arena.
+        map.erase(keys[1]);
+        for (int i = 0; map.size() < map.bucket_count(); i++) {
+            map.insert("filler" + std::to_string(i), 0);
+        }
+        std::string_view stored;
+        map.for_each([&](std::string_view key, int &) {
+            stored = key.size() > StringKeyMap<int>::InlineKeyLength ? key : stored;
+        });
+        const std::string expected(stored.substr(1));
+        ASSERT_TRUE(map.insert(stored.substr(1), -1));
+        ASSERT_EQ(-1, *map.find(expected));
+
+        // Shrinking a nearly empty map gives back the buckets of the full one as well.
+        const auto fullBuckets = map.bucket_count();
+        for (int i = 0; i < 3000; i++) {
+            map.erase(keys[i]);
+        }
+        map.shrink_to_fit();
+        ASSERT_LT(map.memory_usage(), fullBuckets * sizeof(int));
+    }
+
+#if defined(__unix__)
+    TEST(PublicSharedMap, ReadersInOtherProcessesSeeTheWriter) {
+        const auto name = "/hashmap_test_" + std::to_string(getpid());
+        auto writer = SharedHashMap<int, double>::create(name, 1000);
+
+        const auto capacity = static_cast<int>(writer.capacity());
+        for (int i = 0; i < capacity; i++) {
+            ASSERT_TRUE(writer.insert_or_assign(i, i / 2.0));
+        }
+        ASSERT_FALSE(writer.insert_or_assign(7, -1.0));
+        ASSERT_THROW(writer.insert_or_assign(5000, 0.0), std::length_error);
+        ASSERT_EQ(1u, writer.erase(10));
+        ASSERT_TRUE(writer.insert_or_assign(5000, 0.0));
+
+        auto reader = SharedHashMap<int, double>::open(name);
+        const auto version = reader.version();
+
+        ASSERT_TRUE(reader.read_only());
+        ASSERT_EQ(writer.capacity(), reader.size());
+        ASSERT_EQ(-1.0, reader.get(7));
+        ASSERT_FALSE(reader.contains(10));
+        ASSERT_THROW(reader.erase(7), std::logic_error);
+
+        writer.insert_or_assign(7, 3.5);
+        ASSERT_EQ(3.5, reader.get(7));
+        ASSERT_EQ(version + 1, reader.version());
+
+        const auto child = fork();
+        if (child == 0) {
+            auto opened = SharedHashMap<int, double>::open(name);
+            const auto ok = opened.get(999) == 499.5 && opened.get(7) == 3.5 && !opened.get(10).has_value();
+            _exit(ok ? 0 : 1);
+        }
+        int status = -1;
+        waitpid(child, &status, 0);
+        ASSERT_TRUE(WIFEXITED(status));
+        ASSERT_EQ(0, WEXITSTATUS(status));
+
+        using OtherMap = SharedHashMap<int, int>;
+        ASSERT_THROW(OtherMap::open(name), std::runtime_error);
+        SharedHashMap<int, double>::remove(name);
+        ASSERT_THROW((SharedHashMap<int, double>::open(name)), std::runtime_error);
+        ASSERT_EQ(3.5, reader.get(7));
+    }
+
+    TEST(PublicSharedMap, ExistingSegmentIsKeptAndDeadWriterIsDetected) {
+        const auto name = "/hashmap_dead_writer_" + std::to_string(getpid());
+
+        const auto child = fork();
+        if (child == 0) {
+            auto writer = SharedHashMap<int, int>::create(name, 10);
+            writer.insert_or_assign(1, 1);
+
+            // Dies as if in the middle of a change.
+            const auto descriptor = shm_open(name.c_str(), O_RDWR, 0);
+            auto *header = static_cast<SharedMapDetails::Header *>(
+                mmap(nullptr, sizeof(SharedMapDetails::Header), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0));
+            header->sequence++;
+            _exit(0);
+        }
+        int status = -1;
+        waitpid(child, &status, 0);
+        ASSERT_TRUE(WIFEXITED(status));
+
+        ASSERT_THROW((SharedHashMap<int, int>::create(name, 10)), std::runtime_error);
+        auto reader = SharedHashMap<int, int>::open(name);
+        ASSERT_THROW(reader.get(1), std::runtime_error);
+        ASSERT_THROW((void) reader.version(), std::runtime_error);
+
+        SharedHashMap<int, int>::remove(name);
+        auto writer = SharedHashMap<int, int>::create(name, 10);
+        writer.insert_or_assign(1, 2);
+        ASSERT_EQ(2, (SharedHashMap<int, int>::open(name).get(1)));
+        SharedHashMap<int, int>::remove(name);
+    }
+
+    TEST(PublicDurableMap, RecoversCommittedGroupsAndDropsTornTail) {
+        const auto directory = testing::TempDir() + "durable_" + std::to_string(getpid());
+        std::filesystem::remove_all(directory);
+        DurabilityOptions options;
+        options.groupCommitRecords = 100;
+        options.groupCommitDelay = std::chrono::hours(1);
+        options.syncOnCommit = false;
+
+        {
+            DurableHashMap<std::string, int> map(directory, options);
+            for (int i = 0; i < 1000; i++) {
+                ASSERT_TRUE(map.insert("key" + std::to_string(i), i));
+            }
+            ASSERT_FALSE(map.insert("key5", -5));
+            ASSERT_EQ(1u, map.erase("key7"));
+            ASSERT_EQ(0u, map.erase("key7"));
+            map.insert_or_assign("key8", -8);
+            map.commit();
+            map.insert_or_assign("key9", -9);
+            ASSERT_EQ(1u, map.pending_records());
+
+            // Another process opening the directory now sees the committed groups only.
+            DurableHashMap<std::string, int> reopened(directory, options);
+            ASSERT_EQ(999u, reopened.size());
+            ASSERT_EQ(1002u, reopened.recovery_stats().replayedRecords);
+            ASSERT_EQ(-8, *reopened.get("key8"));
+            ASSERT_EQ(9, *reopened.get("key9"));
+            ASSERT_EQ(nullptr, reopened.get("key7"));
+        }
+
+        {
+            std::ofstream out(directory + "/log", std::ios::binary | std::ios::app);
+            out.write("\20\0\0\0garbage", 11);
+        }
+
+        DurableHashMap<std::string, int> map(directory, options);
+        ASSERT_EQ(11u, map.recovery_stats().discardedBytes);
+        ASSERT_EQ(999u, map.size());
+        ASSERT_EQ(-9, *map.get("key9"));
+
+        map.checkpoint();
+        ASSERT_EQ(0u, std::filesystem::file_size(directory + "/log"));
+        map.erase("key1");
+        map.insert_or_assign("key1000", 1000);
+        map.commit();
+
+        DurableHashMap<std::string, int> recovered(directory, options);
+        ASSERT_EQ(999u, recovered.recovery_stats().checkpointPairs);
+        ASSERT_EQ(2u, recovered.recovery_stats().replayedRecords);
+        ASSERT_EQ(999u, recovered.size());
+        ASSERT_FALSE(recovered.contains("key1"));
+        ASSERT_EQ(1000, *recovered.get("key1000"));
+        ASSERT_EQ(-8, *recovered.get("key8"));
+        std::filesystem::remove_all(directory);
+    }
+
+    TEST(PublicDurableMap, UnreadableFilesThrowInsteadOfLookingEmpty) {
+        const auto directory = testing::TempDir() + "durable_unreadable_" + std::to_string(getpid());
+        std::filesystem::remove_all(directory);
+
+        {
+            DurableHashMap<std::string, int> map(directory);
+            map.insert("key", 1);
+        }
+        const auto logBytes = std::filesystem::file_size(directory + "/log");
+
+        // Reading a directory fails, and the checkpoint must not be taken as missing.
+        std::filesystem::create_directory(directory + "/checkpoint");
+        ASSERT_THROW((DurableHashMap<std::string, int>(directory)), std::runtime_error);
+        ASSERT_EQ(logBytes, std::filesystem::file_size(directory + "/log"));
+
+        std::filesystem::remove(directory + "/checkpoint");
+        DurableHashMap<std::string, int> map(directory);
+        ASSERT_EQ(1, *map.get("key"));
+        std::filesystem::remove_all(directory);
+    }
+
+    TEST(PublicDurableMap, FailedGroupWriteIsCutOffAndRetried) {
+        const auto directory = testing::TempDir() + "durable_torn_" + std::to_string(getpid());
+        std::filesystem::remove_all(directory);
+        DurabilityOptions options;
+        options.groupCommitRecords = 1000;
+        options.groupCommitDelay = std::chrono::hours(1);
+        options.syncOnCommit = false;
+
+        // The file size limit makes the second group write partly, then fail.
+        const auto child = fork();
+        if (child == 0) {
+            signal(SIGXFSZ, SIG_IGN);
+            DurableHashMap<std::string, int> map(directory, options);
+            for (int i = 0; i < 100; i++) {
+                map.insert("key" + std::to_string(i), i);
+            }
+            map.commit();
+
+            rlimit limit {};
+            getrlimit(RLIMIT_FSIZE, &limit);
+            const auto original = limit.rlim_cur;
+            limit.rlim_cur = std::filesystem::file_size(directory + "/log") + 100;
+            setrlimit(RLIMIT_FSIZE, &limit);
+
+            for (int i = 100; i < 200; i++) {
+                map.insert("key" + std::to_string(i), i);
+            }
+            bool failed = false;
+            try {
+                map.commit();
+            } catch (const std::runtime_error &) {
+                failed = true;
+            }
+
+            limit.rlim_cur = original;
+            setrlimit(RLIMIT_FSIZE, &limit);
+            map.commit();
+            map.insert("key200", 200);
+            map.commit();
+            _exit(failed && map.pending_records() == 0 ? 0 : 1);
+        }
+        int status = -1;
+        waitpid(child, &status, 0);
+        ASSERT_TRUE(WIFEXITED(status));
+        ASSERT_EQ(0, WEXITSTATUS(status));
+
+        DurableHashMap<std::string, int> recovered(directory, options);
+        ASSERT_EQ(0u, recovered.recovery_stats().discardedBytes);
+        ASSERT_EQ(201u, recovered.recovery_stats().replayedRecords);
+        ASSERT_EQ(201u, recovered.size());
+        ASSERT_EQ(200, *recovered.get("key200"));
+        std::filesystem::remove_all(directory);
+    }
+#endif
 }
@@ -0,0 +1,87 @@
+#include "entry_point.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+using ::testing::UnorderedElementsAre;
+
+namespace Task04 {
+    TEST(PublicSet, Insert) {
+        HashSet<std::string> set;
+
+        auto [inserted, it] = set.insert("a");
+        set.insert("b");
+        set.insert(std::string("c"));
+
+        ASSERT_TRUE(inserted);
+        ASSERT_EQ("a", *it);
+        ASSERT_FALSE(set.insert("a").first);
+        EXPECT_EQ(3u, set.size());
+    }
+
+    TEST(PublicSet, Contains) {
+        HashSet<std::string> set = {"a", "b", "c"};
+
+        EXPECT_TRUE(set.contains("a"));
+        EXPECT_TRUE(set.contains("b"));
+        EXPECT_TRUE(set.contains("c"));
+        EXPECT_FALSE(set.contains("u"));
+    }
+
+    TEST(PublicSet, Iteration) {
+        HashSet<std::string> set = {"a", "b", "c", "d", "e"};
+
+        std::vector<std::string> res;
+        for (const auto &key : set) {
+            res.emplace_back(key);
+        }
+
+        EXPECT_THAT(res, UnorderedElementsAre("a", "b", "c", "d", "e"));
+    }
+
+    TEST(PublicSet, Find) {
+        HashSet<std::string> set = {"a", "b", "c"};
+
+        EXPECT_EQ(set.find("u"), set.end());
+        ASSERT_NE(set.find("b"), set.end());
+        EXPECT_EQ(*set.find("b"), "b");
+    }
+
+    TEST(PublicSet, Erase) {
+        HashSet<std::string> set = {"a", "b", "c", "d", "e"};
+
+        set.erase(set.find("e"));
+        EXPECT_EQ(1u, set.erase("a"));
+        EXPECT_EQ(0u, set.erase("a"));
+
+        EXPECT_THAT(set, UnorderedElementsAre("b", "c", "d"));
+    }
+
+    TEST(PublicSet, EraseCanClearSet) {
+        HashSet<int> set;
+        for (int i = 0; i < 1000; i++) {
+            set.insert(i);
+        }
+
+        auto current = set.begin();
+        while (set.size() != 0) {
+            current = set.erase(current);
+        }
+
+        EXPECT_THAT(set, UnorderedElementsAre());
+    }
+
+    TEST(PublicSet, CopyAndMove) {
+        HashSet<int> set = {1, 2, 3};
+        HashSet<int> copy = set;
+        HashSet<int> moved = std::move(set);
+
+        copy.insert(4);
+
+        EXPECT_THAT(copy, UnorderedElementsAre(1, 2, 3, 4));
+        EXPECT_THAT(moved, UnorderedElementsAre(1, 2, 3));
+    }
+}
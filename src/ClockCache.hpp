@@ -0,0 +1,171 @@
+#pragma once
+
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "HashTable.hpp"
+
+// Bounded cache evicting with the CLOCK algorithm.
+// The table is sized for maxSize elements up front and never grows: the hand sweeps the entries array,
+// clearing reference bits, and the first unreferenced entry is evicted through the deleted list,
+// so the next insertion takes over its slot.
+template<class TKey, class TValue, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+class ClockCache : private HashTable<TKey, std::pair<const TKey, TValue>, KeyOfPair, Hasher, KeyEqualComparer> {
+    using Base = HashTable<TKey, std::pair<const TKey, TValue>, KeyOfPair, Hasher, KeyEqualComparer>;
+
+public:
+    using KeyValuePair = std::pair<const TKey, TValue>;
+
+    using typename Base::ConstIterator;
+
+    using Base::size;
+    using Base::contains;
+    using Base::begin;
+    using Base::end;
+
+    explicit ClockCache(size_t maxSize,
+                        const Hasher &hasher = Hasher(),
+                        const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : Base(hasher, keyEqualComparer), maxSize(maxSize) {
+        if (maxSize == 0) {
+            throw std::invalid_argument("Cache must be able to hold at least one element");
+        }
+
+        hand = 0;
+        hitsAmount = missesAmount = evictionsAmount = 0;
+
+        Reset();
+    }
+
+    ClockCache(const ClockCache &other) = delete;
+
+    ClockCache &operator=(const ClockCache &other) = delete;
+
+    [[nodiscard]] size_t max_size() const {
+        return maxSize;
+    }
+
+    [[nodiscard]] size_t hits() const {
+        return hitsAmount;
+    }
+
+    [[nodiscard]] size_t misses() const {
+        return missesAmount;
+    }
+
+    [[nodiscard]] size_t evictions() const {
+        return evictionsAmount;
+    }
+
+    // Returns the cached value or nullptr; the pointer is valid until the next put or load.
+    TValue *get(const TKey &key) {
+        const auto index = TryFindEntryIndex(key, std::invoke(hasher, key));
+
+        if (index == -1) {
+            missesAmount++;
+
+            return nullptr;
+        }
+
+        hitsAmount++;
+        referenced[index] = true;
+
+        return &entries[index].node->second;
+    }
+
+    void put(const TKey &key, TValue value) {
+        const auto hash = std::invoke(hasher, key);
+        const auto index = TryFindEntryIndex(key, hash);
+
+        if (index != -1) {
+            entries[index].node->second = std::move(value);
+            referenced[index] = true;
+
+            return;
+        }
+
+        Insert(hash, key, std::move(value));
+    }
+
+    // Returns the cached value, calling loader(key) and caching its result on a miss.
+    template <class Loader>
+    TValue &get_or_load(const TKey &key, Loader loader) {
+        const auto hash = std::invoke(hasher, key);
+        auto index = TryFindEntryIndex(key, hash);
+
+        if (index != -1) {
+            hitsAmount++;
+            referenced[index] = true;
+        } else {
+            missesAmount++;
+            index = Insert(hash, key, std::invoke(loader, key));
+        }
+
+        return entries[index].node->second;
+    }
+
+    size_t erase(const TKey &key) {
+        return Base::erase(key);
+    }
+
+    void clear() {
+        Base::clear();
+        Reset();
+    }
+
+private:
+    using Base::hasher;
+    using Base::entries;
+    using Base::capacity;
+    using Base::TryFindEntryIndex;
+    using Base::CreateAndGetEntryIndex;
+
+    size_t maxSize;
+    size_t hand;
+    size_t hitsAmount;
+    size_t missesAmount;
+    size_t evictionsAmount;
+    std::vector<bool> referenced;
+
+    void Reset() {
+        this->Initialize(maxSize);
+        referenced.assign(capacity, false);
+        hand = 0;
+    }
+
+    int Insert(size_t hash, const TKey &key, TValue &&value) {
+        if (size() == maxSize) {
+            EvictOne();
+        }
+
+        const auto index = CreateAndGetEntryIndex(
+            hash, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::move(value)));
+        referenced[index] = false;
+
+        return index;
+    }
+
+    void EvictOne() {
+        const auto used = this->usedEntriesAmount;
+
+        while (true) {
+            auto &entry = entries[hand];
+
+            if (entry.node != nullptr) {
+                if (!referenced[hand]) {
+                    this->DestroyNode(this->DetachEntry(static_cast<int>(entry.hash % capacity), static_cast<int>(hand)));
+                    evictionsAmount++;
+                    hand = (hand + 1) % used;
+
+                    return;
+                }
+
+                referenced[hand] = false;
+            }
+
+            hand = (hand + 1) % used;
+        }
+    }
+};
@@ -0,0 +1,527 @@
+#pragma once
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "HashMap.hpp"
+#include "Hashers.hpp"
+#include "RecordCodec.hpp"
+
+struct DurabilityOptions {
+    // Log records collected before they are written and synced together.
+    size_t groupCommitRecords = 256;
+
+    // A pending group older than this is committed by the next update even if it is not full.
+    std::chrono::microseconds groupCommitDelay = std::chrono::milliseconds(10);
+
+    // fdatasync after every group; without it a group survives a crash of the process but not of the host.
+    bool syncOnCommit = true;
+
+    // The table is checkpointed and the log emptied once the log grows past this many bytes.
+    size_t checkpointLogBytes = 64 << 20;
+};
+
+struct RecoveryStats {
+    size_t checkpointPairs = 0;
+    size_t replayedRecords = 0;
+    // Bytes of a torn or corrupted log tail cut off during recovery.
+    size_t discardedBytes = 0;
+    double seconds = 0;
+};
+
+namespace DurableMapDetails {
+    constexpr uint64_t CheckpointMagic = 0x31746e696f706b43ull;
+
+    enum class RecordKind : uint8_t {
+        Put = 1,
+        Erase = 2,
+    };
+
+    // Length of the payload, checksum of kind and payload, kind.
+    constexpr size_t RecordHeaderLength = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint8_t);
+
+    inline uint32_t Checksum(std::string_view bytes) {
+        return static_cast<uint32_t>(FastHashing::HashBytes(bytes.data(), bytes.size(), 0));
+    }
+
+    // The content of the file, std::nullopt if it does not exist. Any other failure throws: a log read short
+    // would pass for a torn tail and be cut, a checkpoint that failed to read would be replaced by the next one.
+    inline std::optional<std::string> ReadWholeFile(const std::filesystem::path &path) {
+        const auto descriptor = ::open(path.c_str(), O_RDONLY);
+
+        if (descriptor == -1) {
+            if (errno == ENOENT) {
+                return std::nullopt;
+            }
+
+            throw std::runtime_error("cannot open " + path.string());
+        }
+
+        std::string content;
+        struct stat status {};
+
+        if (fstat(descriptor, &status) == -1) {
+            ::close(descriptor);
+
+            throw std::runtime_error("cannot read " + path.string());
+        }
+
+        content.resize(static_cast<size_t>(status.st_size));
+
+        for (size_t offset = 0; offset < content.size();) {
+            const auto read = ::read(descriptor, content.data() + offset, content.size() - offset);
+
+            if (read < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (read < 0) {
+                ::close(descriptor);
+
+                throw std::runtime_error("cannot read " + path.string());
+            }
+
+            // The file got shorter since fstat, what is left is all there is.
+            if (read == 0) {
+                content.resize(offset);
+                break;
+            }
+
+            offset += static_cast<size_t>(read);
+        }
+
+        ::close(descriptor);
+
+        return content;
+    }
+
+    inline void WriteAll(int descriptor, std::string_view bytes, const char *what) {
+        while (!bytes.empty()) {
+            const auto written = ::write(descriptor, bytes.data(), bytes.size());
+
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (written < 0) {
+                throw std::runtime_error(std::string("cannot write ") + what);
+            }
+
+            bytes.remove_prefix(static_cast<size_t>(written));
+        }
+    }
+
+    // Makes a rename in the directory durable.
+    inline void SyncDirectory(const std::filesystem::path &directory) {
+        const auto descriptor = ::open(directory.c_str(), O_RDONLY);
+
+        if (descriptor == -1) {
+            throw std::runtime_error("cannot open directory " + directory.string());
+        }
+
+        const auto synced = ::fsync(descriptor) == 0;
+
+        ::close(descriptor);
+
+        if (!synced) {
+            throw std::runtime_error("cannot sync directory " + directory.string());
+        }
+    }
+}
+
+// HashMap whose updates survive restarts. Every change is appended to a log in the directory as a compact
+// checksummed record; records are collected into groups that are written and synced together, so the cost
+// of a sync is shared by a whole group. commit() forces the pending group out, and an update is durable
+// once its group is committed. Checkpoints write the whole table to a new file that replaces the previous
+// one by rename, after which the log starts over.
+// Opening a directory recovers the map: the checkpoint is loaded through insert_bulk, the log tail is folded
+// into the last change of every key and applied the same way; a torn record at the end of the log is cut off.
+// A checkpoint or log that exists but cannot be read throws instead of passing for an empty one.
+// A checkpoint logs the pending group first, so a crash between writing a checkpoint and emptying the log
+// leaves records that are all part of the checkpoint, and replaying them again changes nothing, since the
+// last change of each key wins either way. Every write and sync is checked: a failed one throws, cuts the
+// group off the log and keeps it pending for the next commit, and a failed checkpoint leaves the previous
+// checkpoint and the log.
+// Keys and values are strings or trivially copyable types.
+template<class TKey, class TValue, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+class DurableHashMap {
+public:
+    using Map = HashMap<TKey, TValue, Hasher, KeyEqualComparer>;
+
+    explicit DurableHashMap(const std::filesystem::path &directory,
+                            const DurabilityOptions &options = DurabilityOptions(),
+                            const Hasher &hasher = Hasher(),
+                            const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : directory(directory), options(options), map(HashMapOptions(), hasher, keyEqualComparer) {
+        std::filesystem::create_directories(directory);
+
+        Recover();
+
+        logDescriptor = ::open(LogPath().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+        if (logDescriptor == -1) {
+            throw std::runtime_error("cannot open log in " + directory.string());
+        }
+    }
+
+    DurableHashMap(const DurableHashMap &other) = delete;
+
+    DurableHashMap &operator=(const DurableHashMap &other) = delete;
+
+    // Commits the pending group; errors are swallowed here, call commit() to see them.
+    ~DurableHashMap() {
+        try {
+            commit();
+        } catch (...) {
+        }
+
+        ::close(logDescriptor);
+    }
+
+    // Read access to the recovered and updated pairs; changes have to go through this class to be logged.
+    [[nodiscard]] const Map &pairs() const {
+        return map;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return map.size();
+    }
+
+    bool contains(const TKey &key) const {
+        return map.contains(key);
+    }
+
+    const TValue *get(const TKey &key) const {
+        const auto position = map.find(key);
+
+        return position != map.end() ? &position->second : nullptr;
+    }
+
+    [[nodiscard]] const RecoveryStats &recovery_stats() const {
+        return recoveryStats;
+    }
+
+    // Records waiting for the next group commit.
+    [[nodiscard]] size_t pending_records() const {
+        return pendingRecords;
+    }
+
+    // Inserts the pair if the key is absent; returns true if it was inserted.
+    bool insert(const TKey &key, const TValue &value) {
+        if (!map.try_emplace(key, value).first) {
+            return false;
+        }
+
+        Log(DurableMapDetails::RecordKind::Put, key, &value);
+
+        return true;
+    }
+
+    // Stands in for assignments through operator[], which cannot be observed from outside the map.
+    // Returns true if the key was absent.
+    bool insert_or_assign(const TKey &key, const TValue &value) {
+        const auto inserted = map.insert_or_assign(key, value).first;
+
+        Log(DurableMapDetails::RecordKind::Put, key, &value);
+
+        return inserted;
+    }
+
+    size_t erase(const TKey &key) {
+        if (map.erase(key) == 0) {
+            return 0;
+        }
+
+        Log(DurableMapDetails::RecordKind::Erase, key, nullptr);
+
+        return 1;
+    }
+
+    // Writes and syncs the pending group.
+    void commit() {
+        if (pendingRecords == 0) {
+            return;
+        }
+
+        WritePending(options.syncOnCommit);
+
+        if (logBytes >= options.checkpointLogBytes) {
+            checkpoint();
+        }
+    }
+
+    // Replaces the checkpoint with the current table and empties the log.
+    void checkpoint() {
+        // The log must hold every change the checkpoint does before it may be replayed over it.
+        if (pendingRecords > 0) {
+            WritePending(true);
+        }
+
+        std::string content;
+        const auto count = static_cast<uint64_t>(map.size());
+
+        RecordCodec::Append(content, DurableMapDetails::CheckpointMagic);
+        RecordCodec::Append(content, count);
+
+        for (const auto &[key, value] : map) {
+            RecordCodec::Append(content, key);
+            RecordCodec::Append(content, value);
+        }
+
+        RecordCodec::Append(content, DurableMapDetails::Checksum(content));
+
+        const auto temporaryPath = directory / "checkpoint.tmp";
+        const auto descriptor = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if (descriptor == -1) {
+            throw std::runtime_error("cannot create checkpoint in " + directory.string());
+        }
+
+        try {
+            DurableMapDetails::WriteAll(descriptor, content, "checkpoint");
+
+            if (::fsync(descriptor) == -1) {
+                throw std::runtime_error("cannot sync checkpoint in " + directory.string());
+            }
+        } catch (...) {
+            ::close(descriptor);
+            std::filesystem::remove(temporaryPath);
+            throw;
+        }
+
+        if (::close(descriptor) == -1) {
+            std::filesystem::remove(temporaryPath);
+
+            throw std::runtime_error("cannot write checkpoint in " + directory.string());
+        }
+
+        std::filesystem::rename(temporaryPath, CheckpointPath());
+        DurableMapDetails::SyncDirectory(directory);
+
+        if (::ftruncate(logDescriptor, 0) == -1) {
+            throw std::runtime_error("cannot truncate log in " + directory.string());
+        }
+
+        logBytes = 0;
+
+        // A truncation lost in a crash leaves a log that is replayed over the checkpoint without harm.
+        if (::fsync(logDescriptor) == -1) {
+            throw std::runtime_error("cannot sync log in " + directory.string());
+        }
+    }
+
+private:
+    std::filesystem::path directory;
+    DurabilityOptions options;
+    Map map;
+    int logDescriptor = -1;
+    // Length of the committed groups in the log.
+    size_t logBytes = 0;
+    // A failed write left bytes past logBytes that could not be cut off yet.
+    bool logTorn = false;
+    std::string pending;
+    size_t pendingRecords = 0;
+    std::chrono::steady_clock::time_point pendingSince;
+    RecoveryStats recoveryStats;
+
+    [[nodiscard]] std::filesystem::path LogPath() const {
+        return directory / "log";
+    }
+
+    [[nodiscard]] std::filesystem::path CheckpointPath() const {
+        return directory / "checkpoint";
+    }
+
+    // Appends the pending group to the log, synced if `sync`. If anything fails the group stays pending and
+    // the log is cut back to its committed length: recovery stops at the first torn record, so a partial group
+    // left in the middle of the log would hide every group written after it. A log that could not be cut
+    // back is cut before the retry writes anything.
+    void WritePending(bool sync) {
+        if (logTorn && ::ftruncate(logDescriptor, static_cast<off_t>(logBytes)) == -1) {
+            throw std::runtime_error("cannot cut torn log back in " + directory.string());
+        }
+
+        logTorn = false;
+
+        try {
+            DurableMapDetails::WriteAll(logDescriptor, pending, "log");
+
+            if (sync && ::fdatasync(logDescriptor) == -1) {
+                throw std::runtime_error("cannot sync log in " + directory.string());
+            }
+        } catch (...) {
+            logTorn = ::ftruncate(logDescriptor, static_cast<off_t>(logBytes)) == -1;
+            throw;
+        }
+
+        logBytes += pending.size();
+        pending.clear();
+        pendingRecords = 0;
+    }
+
+    void Log(DurableMapDetails::RecordKind kind, const TKey &key, const TValue *value) {
+        const auto now = std::chrono::steady_clock::now();
+
+        if (pendingRecords == 0) {
+            pendingSince = now;
+        }
+
+        const auto start = pending.size();
+
+        pending.append(DurableMapDetails::RecordHeaderLength, '\0');
+        pending[start + DurableMapDetails::RecordHeaderLength - 1] = static_cast<char>(kind);
+        RecordCodec::Append(pending, key);
+
+        if (value != nullptr) {
+            RecordCodec::Append(pending, *value);
+        }
+
+        const auto payloadLength = static_cast<uint32_t>(pending.size() - start - DurableMapDetails::RecordHeaderLength);
+        const auto checksum = DurableMapDetails::Checksum(
+            std::string_view(pending).substr(start + DurableMapDetails::RecordHeaderLength - 1));
+
+        std::memcpy(pending.data() + start, &payloadLength, sizeof(payloadLength));
+        std::memcpy(pending.data() + start + sizeof(payloadLength), &checksum, sizeof(checksum));
+
+        if (++pendingRecords >= options.groupCommitRecords || now - pendingSince >= options.groupCommitDelay) {
+            commit();
+        }
+    }
+
+    void Recover() {
+        const auto start = std::chrono::steady_clock::now();
+
+        LoadCheckpoint();
+        ReplayLog();
+
+        recoveryStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void LoadCheckpoint() {
+        const auto file = DurableMapDetails::ReadWholeFile(CheckpointPath());
+
+        if (!file.has_value()) {
+            return;
+        }
+
+        const auto &content = *file;
+        std::string_view input = content;
+        uint64_t magic = 0, count = 0;
+        uint32_t checksum = 0;
+
+        if (input.size() < sizeof(checksum) + 2 * sizeof(uint64_t)
+            || !RecordCodec::Parse(input, magic) || magic != DurableMapDetails::CheckpointMagic
+            || !RecordCodec::Parse(input, count)) {
+            throw std::runtime_error("not a checkpoint: " + CheckpointPath().string());
+        }
+
+        std::memcpy(&checksum, content.data() + content.size() - sizeof(checksum), sizeof(checksum));
+        input.remove_suffix(sizeof(checksum));
+
+        if (checksum != DurableMapDetails::Checksum(std::string_view(content).substr(0, content.size() - sizeof(checksum)))) {
+            throw std::runtime_error("corrupted checkpoint: " + CheckpointPath().string());
+        }
+
+        std::vector<std::pair<TKey, TValue>> items(count);
+        std::vector<size_t> hashes(count);
+
+        for (size_t i = 0; i < count; i++) {
+            if (!RecordCodec::Parse(input, items[i].first) || !RecordCodec::Parse(input, items[i].second)) {
+                throw std::runtime_error("corrupted checkpoint: " + CheckpointPath().string());
+            }
+
+            hashes[i] = std::invoke(map.hash_function(), items[i].first);
+        }
+
+        map.reserve(count);
+        recoveryStats.checkpointPairs = map.insert_bulk(std::move(items), hashes);
+    }
+
+    // Folds the log into the last change of every key, then erases, assigns and bulk inserts accordingly.
+    void ReplayLog() {
+        const auto content = DurableMapDetails::ReadWholeFile(LogPath()).value_or(std::string());
+        HashMap<TKey, std::optional<TValue>, Hasher, KeyEqualComparer> changes(
+            HashMapOptions(), map.hash_function());
+        std::string_view input = content;
+
+        while (input.size() >= DurableMapDetails::RecordHeaderLength) {
+            uint32_t payloadLength, checksum;
+
+            std::memcpy(&payloadLength, input.data(), sizeof(payloadLength));
+            std::memcpy(&checksum, input.data() + sizeof(payloadLength), sizeof(checksum));
+
+            if (input.size() - DurableMapDetails::RecordHeaderLength < payloadLength) {
+                break;
+            }
+
+            const auto checked = input.substr(DurableMapDetails::RecordHeaderLength - 1, payloadLength + 1);
+
+            if (checksum != DurableMapDetails::Checksum(checked)) {
+                break;
+            }
+
+            const auto kind = static_cast<DurableMapDetails::RecordKind>(checked[0]);
+            auto payload = checked.substr(1);
+            TKey key;
+            std::optional<TValue> value;
+
+            if (!RecordCodec::Parse(payload, key)) {
+                break;
+            }
+
+            if (kind == DurableMapDetails::RecordKind::Put) {
+                value.emplace();
+
+                if (!RecordCodec::Parse(payload, *value)) {
+                    break;
+                }
+            }
+
+            changes.insert_or_assign(std::move(key), std::move(value));
+            input.remove_prefix(DurableMapDetails::RecordHeaderLength + payloadLength);
+            recoveryStats.replayedRecords++;
+        }
+
+        std::vector<std::pair<TKey, TValue>> inserted;
+        std::vector<size_t> hashes;
+
+        for (auto &[key, value] : changes) {
+            if (!value.has_value()) {
+                map.erase(key);
+            } else if (auto position = map.find(key); position != map.end()) {
+                position->second = std::move(*value);
+            } else {
+                hashes.push_back(std::invoke(map.hash_function(), key));
+                inserted.emplace_back(key, std::move(*value));
+            }
+        }
+
+        map.insert_bulk(std::move(inserted), hashes);
+
+        logBytes = content.size() - input.size();
+        recoveryStats.discardedBytes = input.size();
+
+        if (!input.empty()) {
+            std::filesystem::resize_file(LogPath(), logBytes);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <vector>
+
+#include "HashTable.hpp"
+
+// Map whose pairs expire after a per-pair time to live.
+// Expired pairs are treated as missing by lookups, which also drop them. expire(now) removes every due pair
+// in one pass over a hierarchical timer wheel whose timers are linked by entry index, so its cost depends on
+// the number of expired pairs and elapsed ticks rather than on the size of the map.
+// Time is measured in ticks of `resolution`; a pair may outlive its deadline by less than one tick.
+template<class TKey, class TValue, class Clock = std::chrono::steady_clock,
+         class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+class ExpiringHashMap : private HashTable<TKey, std::pair<const TKey, TValue>, KeyOfPair, Hasher, KeyEqualComparer> {
+    using Base = HashTable<TKey, std::pair<const TKey, TValue>, KeyOfPair, Hasher, KeyEqualComparer>;
+
+public:
+    using KeyValuePair = std::pair<const TKey, TValue>;
+    using TimePoint = typename Clock::time_point;
+    using Duration = typename Clock::duration;
+
+    // Number of pairs including expired ones that were not collected yet.
+    using Base::size;
+    using Base::begin;
+    using Base::end;
+
+    explicit ExpiringHashMap(Duration resolution = std::chrono::milliseconds(1),
+                             Clock clock = Clock(),
+                             const Hasher &hasher = Hasher(),
+                             const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : Base(hasher, keyEqualComparer), clock(clock), resolution(resolution) {
+        std::fill(std::begin(slots), std::end(slots), -1);
+        currentTick = ToTick(this->clock.now());
+        scheduledAmount = 0;
+    }
+
+    ExpiringHashMap(const ExpiringHashMap &other) = delete;
+
+    ExpiringHashMap &operator=(const ExpiringHashMap &other) = delete;
+
+    void put(const TKey &key, TValue value, Duration timeToLive) {
+        const auto hash = std::invoke(hasher, key);
+        auto index = TryFindEntryIndex(key, hash);
+
+        if (index != -1) {
+            entries[index].node->second = std::move(value);
+            Unschedule(index);
+        } else {
+            index = CreateAndGetEntryIndex(
+                hash, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::move(value)));
+
+            if (timers.size() < capacity) {
+                timers.resize(capacity);
+            }
+        }
+
+        timers[index].expiry = ToTick(clock.now() + timeToLive + resolution - Duration(1));
+        Schedule(index, currentTick + 1);
+    }
+
+    // Returns the value if the pair exists and has not expired, nullptr otherwise.
+    TValue *get(const TKey &key) {
+        const auto index = FindAlive(key);
+
+        return index != -1 ? &entries[index].node->second : nullptr;
+    }
+
+    bool contains(const TKey &key) {
+        return FindAlive(key) != -1;
+    }
+
+    size_t erase(const TKey &key) {
+        const auto index = TryFindEntryIndex(key, std::invoke(hasher, key));
+
+        if (index == -1) {
+            return 0;
+        }
+
+        Unschedule(index);
+        Remove(index);
+
+        return 1;
+    }
+
+    void clear() {
+        Base::clear();
+        timers.clear();
+        std::fill(std::begin(slots), std::end(slots), -1);
+        scheduledAmount = 0;
+    }
+
+    size_t expire() {
+        return expire(clock.now());
+    }
+
+    // Removes every pair due at or before `now`, returns the number of removed pairs.
+    size_t expire(TimePoint now) {
+        const auto target = ToTick(now);
+        size_t removed = 0;
+
+        while (currentTick < target) {
+            if (scheduledAmount == 0) {
+                currentTick = target;
+                break;
+            }
+
+            currentTick++;
+            Cascade();
+            removed += RemoveDue(static_cast<int>(currentTick & SlotMask));
+        }
+
+        return removed;
+    }
+
+private:
+    static constexpr int SlotBits = 6;
+    static constexpr int SlotsPerLevel = 1 << SlotBits;
+    static constexpr uint64_t SlotMask = SlotsPerLevel - 1;
+    static constexpr int Levels = 4;
+    static constexpr int OverflowSlot = Levels * SlotsPerLevel;
+
+    struct Timer {
+        uint64_t expiry = 0;
+        int previous = -1;
+        int next = -1;
+        int slot = -1;
+    };
+
+    using Base::hasher;
+    using Base::entries;
+    using Base::capacity;
+    using Base::TryFindEntryIndex;
+    using Base::CreateAndGetEntryIndex;
+
+    Clock clock;
+    Duration resolution;
+    uint64_t currentTick;
+    size_t scheduledAmount;
+    // Indexed by entry index, grows together with the entries array.
+    std::vector<Timer> timers;
+    int slots[OverflowSlot + 1];
+
+    uint64_t ToTick(TimePoint time) const {
+        return static_cast<uint64_t>(time.time_since_epoch() / resolution);
+    }
+
+    int FindAlive(const TKey &key) {
+        const auto index = TryFindEntryIndex(key, std::invoke(hasher, key));
+
+        if (index != -1 && timers[index].expiry <= ToTick(clock.now())) {
+            Unschedule(index);
+            Remove(index);
+
+            return -1;
+        }
+
+        return index;
+    }
+
+    void Remove(int index) {
+        const auto bucket = static_cast<int>(entries[index].hash % capacity);
+
+        this->DestroyNode(this->DetachEntry(bucket, index));
+    }
+
+    // Puts the timer on the lowest level whose span still covers its expiry, never earlier than `earliest`.
+    void Schedule(int index, uint64_t earliest) {
+        const auto due = std::max(timers[index].expiry, earliest);
+
+        for (int level = 0; level < Levels; level++) {
+            const auto above = SlotBits * (level + 1);
+
+            if ((due >> above) == (currentTick >> above)) {
+                Link(index, level * SlotsPerLevel + static_cast<int>((due >> (SlotBits * level)) & SlotMask));
+
+                return;
+            }
+        }
+
+        Link(index, OverflowSlot);
+    }
+
+    void Link(int index, int slot) {
+        auto &timer = timers[index];
+
+        timer.previous = -1;
+        timer.next = slots[slot];
+        timer.slot = slot;
+
+        if (slots[slot] != -1) {
+            timers[slots[slot]].previous = index;
+        }
+
+        slots[slot] = index;
+        scheduledAmount++;
+    }
+
+    void Unschedule(int index) {
+        auto &timer = timers[index];
+
+        if (timer.previous != -1) {
+            timers[timer.previous].next = timer.next;
+        } else {
+            slots[timer.slot] = timer.next;
+        }
+
+        if (timer.next != -1) {
+            timers[timer.next].previous = timer.previous;
+        }
+
+        timer.slot = -1;
+        scheduledAmount--;
+    }
+
+    // Empties the slot and returns the first timer of its former list.
+    int TakeSlot(int slot) {
+        const auto first = slots[slot];
+
+        slots[slot] = -1;
+
+        for (auto current = first; current != -1; current = timers[current].next) {
+            scheduledAmount--;
+        }
+
+        return first;
+    }
+
+    // When a level wraps around, the next slot of the level above is spread over the levels below.
+    void Cascade() {
+        for (int level = 1; level <= Levels; level++) {
+            if (((currentTick >> (SlotBits * (level - 1))) & SlotMask) != 0) {
+                return;
+            }
+
+            const auto slot = level < Levels
+                              ? level * SlotsPerLevel + static_cast<int>((currentTick >> (SlotBits * level)) & SlotMask)
+                              : OverflowSlot;
+
+            for (auto current = TakeSlot(slot); current != -1;) {
+                const auto next = timers[current].next;
+
+                Schedule(current, currentTick);
+                current = next;
+            }
+        }
+    }
+
+    size_t RemoveDue(int slot) {
+        size_t removed = 0;
+
+        for (auto current = TakeSlot(slot); current != -1;) {
+            const auto next = timers[current].next;
+
+            timers[current].slot = -1;
+
+            if (timers[current].expiry <= currentTick) {
+                Remove(current);
+                removed++;
+            } else {
+                Schedule(current, currentTick + 1);
+            }
+
+            current = next;
+        }
+
+        return removed;
+    }
+};
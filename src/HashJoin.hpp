@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "HashTable.hpp"
+
+enum class JoinKind {
+    // Every (build row, probe row) pair with equal keys.
+    Inner,
+    // Probe rows with at least one equal build key, each reported once.
+    Semi,
+    // Probe rows without an equal build key.
+    Anti,
+};
+
+// Row indices written by HashJoin::probe. Semi and anti joins fill probeIndices only.
+struct JoinOutput {
+    std::vector<size_t> buildIndices;
+    std::vector<size_t> probeIndices;
+
+    void clear() {
+        buildIndices.clear();
+        probeIndices.clear();
+    }
+};
+
+// Equi-join kernel over key columns. The build column becomes a table of distinct keys, each pointing to
+// the list of its build rows threaded through one array. Probe keys are processed in batches: the batch is
+// hashed first, then bucket heads, entries and nodes of the whole batch are prefetched stage by stage,
+// so the cache misses of different keys overlap instead of being paid one after another.
+template<class TKey, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+class HashJoin : private HashTable<TKey, std::pair<const TKey, size_t>, KeyOfPair, Hasher, KeyEqualComparer> {
+    using Base = HashTable<TKey, std::pair<const TKey, size_t>, KeyOfPair, Hasher, KeyEqualComparer>;
+
+public:
+    explicit HashJoin(const Hasher &hasher = Hasher(),
+                      const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : Base(hasher, keyEqualComparer) {
+    }
+
+    [[nodiscard]] size_t build_rows() const {
+        return nextRow.size();
+    }
+
+    [[nodiscard]] size_t distinct_keys() const {
+        return Base::size();
+    }
+
+    // Replaces the build side with a random access column of keys; rows sharing a key are all kept.
+    template <class Keys>
+    void build(const Keys &keys) {
+        const auto rowsCount = static_cast<size_t>(std::size(keys));
+
+        Base::clear();
+        nextRow.assign(rowsCount, NoRow);
+
+        if (rowsCount == 0) {
+            return;
+        }
+
+        this->Initialize(rowsCount);
+
+        // Walking backwards leaves every list in ascending row order.
+        for (auto row = rowsCount; row-- > 0;) {
+            const auto &key = keys[row];
+            const auto hash = std::invoke(hasher, key);
+            const auto index = this->TryFindEntryIndex(key, hash);
+
+            if (index != -1) {
+                nextRow[row] = entries[index].node->second;
+                entries[index].node->second = row;
+            } else {
+                this->CreateAndGetEntryIndex(hash, key, row);
+            }
+        }
+    }
+
+    // Appends the matches of a random access column of probe keys to `output`, returns how many were appended.
+    template <class Keys>
+    size_t probe(const Keys &keys, JoinKind kind, JoinOutput &output) const {
+        const auto rowsCount = static_cast<size_t>(std::size(keys));
+        const auto before = output.probeIndices.size();
+        size_t hashes[BatchLength];
+        int found[BatchLength];
+
+        for (size_t first = 0; first < rowsCount; first += BatchLength) {
+            const auto length = std::min(BatchLength, rowsCount - first);
+
+            for (size_t i = 0; i < length; i++) {
+                hashes[i] = std::invoke(hasher, keys[first + i]);
+            }
+
+            FindBatch(keys, first, length, hashes, found);
+
+            for (size_t i = 0; i < length; i++) {
+                const auto probeRow = first + i;
+
+                if (kind == JoinKind::Anti) {
+                    if (found[i] == -1) {
+                        output.probeIndices.push_back(probeRow);
+                    }
+                } else if (found[i] != -1) {
+                    if (kind == JoinKind::Semi) {
+                        output.probeIndices.push_back(probeRow);
+
+                        continue;
+                    }
+
+                    for (auto row = entries[found[i]].node->second; row != NoRow; row = nextRow[row]) {
+                        output.buildIndices.push_back(row);
+                        output.probeIndices.push_back(probeRow);
+                    }
+                }
+            }
+        }
+
+        return output.probeIndices.size() - before;
+    }
+
+private:
+    static constexpr size_t BatchLength = 32;
+    static constexpr size_t NoRow = SIZE_MAX;
+
+    using Base::hasher;
+    using Base::keyEqualComparer;
+    using Base::entries;
+    using Base::buckets;
+    using Base::capacity;
+
+    // Next build row with the same key, lists start at the node of the key.
+    std::vector<size_t> nextRow;
+
+    // Stores the entry index of every key of the batch, or -1, into `found`.
+    template <class Keys>
+    void FindBatch(const Keys &keys, size_t first, size_t length, const size_t *hashes, int *found) const {
+        if (capacity == 0) {
+            std::fill(found, found + length, -1);
+
+            return;
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            this->Prefetch(&buckets[hashes[i] % capacity]);
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            found[i] = buckets[hashes[i] % capacity];
+
+            if (found[i] >= 0) {
+                this->Prefetch(&entries[found[i]]);
+            }
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            if (found[i] >= 0 && entries[found[i]].hash == hashes[i]) {
+                this->Prefetch(entries[found[i]].node);
+            }
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            auto current = found[i];
+
+            while (current >= 0) {
+                const auto &entry = entries[current];
+
+                if (entry.hash == hashes[i] && std::invoke(keyEqualComparer, keys[first + i], entry.node->first)) {
+                    break;
+                }
+
+                current = this->LinkOf(current).next;
+            }
+
+            found[i] = current;
+        }
+    }
+};
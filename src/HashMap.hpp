@@ -1,196 +1,53 @@
-#include <cstring>
+#pragma once
+
+#include <algorithm>
 #include <functional>
 #include <initializer_list>
-#include <cstddef>
+#include <tuple>
+#include <vector>
 
-#include "PrimesHelper.h"
+#include "HashTable.hpp"
 
-template<class TKey, class TValue, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
-class HashMap {
-public:
-    class Iterator;
+template<class TKey, class TValue, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>, size_t InlineCapacity = 0,
+         EntryLayout Layout = EntryLayout::Interleaved>
+class HashMap : public HashTable<TKey, std::pair<const TKey, TValue>, KeyOfPair, Hasher, KeyEqualComparer, InlineCapacity, Layout> {
+    using Base = HashTable<TKey, std::pair<const TKey, TValue>, KeyOfPair, Hasher, KeyEqualComparer, InlineCapacity, Layout>;
 
+public:
     using KeyValuePair = std::pair<const TKey, TValue>;
+    using mapped_type = TValue;
 
-    using InsertionResult = std::pair<bool, Iterator>;
-
-    class Iterator {
-    public:
-        Iterator(HashMap *map, int entry) : map(map) {
-            currentEntryIndex = entry;
-
-            if (entry != -1) {
-                currentBucketIndex = static_cast<int>(map->entries[currentEntryIndex].hash % map->capacity);
-            } else {
-                currentBucketIndex = -1;
-            }
-        }
-
-        Iterator(const Iterator &other) = default;
-
-        Iterator(Iterator &&other) noexcept = default;
-
-        KeyValuePair &operator*() const {
-            return *map->entries[currentEntryIndex].kvp;
-        }
-
-        KeyValuePair *operator->() const {
-            return map->entries[currentEntryIndex].kvp;
-        }
-
-        Iterator &operator++() {
-            if (currentEntryIndex == -1) {
-                return *this;
-            }
-
-            if (map->entries[currentEntryIndex].next != -1) {
-                currentEntryIndex = map->entries[currentEntryIndex].next;
-            } else {
-                currentBucketIndex++;
-                const auto capacity = static_cast<int>(map->capacity);
-
-                while (currentBucketIndex < capacity && map->buckets[currentBucketIndex] == -1) {
-                    currentBucketIndex++;
-                }
-
-                if (currentBucketIndex < capacity) {
-                    currentEntryIndex = map->buckets[currentBucketIndex];
-                } else {
-                    currentEntryIndex = -1;
-                }
-            }
-
-            return *this;
-        }
-
-        Iterator operator++(int) {
-            return Iterator(++this);
-        }
-
-        bool operator==(const Iterator &other) const {
-            return currentEntryIndex == other.currentEntryIndex;
-        }
-
-        bool operator!=(const Iterator &other) const {
-            return currentEntryIndex != other.currentEntryIndex;
-        }
-
-        Iterator &operator=(const Iterator &other) = default;
-
-        Iterator &operator=(Iterator &&other) noexcept = default;
-
-        [[nodiscard]] int GetEntryIndex() const {
-            return currentEntryIndex;
-        }
-
-    private:
-        HashMap *map;
-        int currentBucketIndex;
-        int currentEntryIndex;
-    };
-
-    class ConstIterator {
-    public:
-        explicit ConstIterator(Iterator wrapped) : wrapped(wrapped) {
-        }
-
-        ConstIterator(const ConstIterator &other) = default;
-
-        ConstIterator(ConstIterator &&other) noexcept = default;
-
-        const KeyValuePair &operator*() const {
-            return wrapped.operator*();
-        }
-
-        const KeyValuePair *operator->() const {
-            return wrapped.operator->();
-        }
-
-        ConstIterator &operator++() {
-            ++wrapped;
-
-            return *this;
-        }
-
-        ConstIterator operator++(int) {
-            return ConstIterator(++wrapped);
-        }
-
-        bool operator==(const ConstIterator &other) const {
-            return wrapped == other.wrapped;
-        }
-
-        bool operator!=(const ConstIterator &other) const {
-            return wrapped != other.wrapped;
-        }
-
-        ConstIterator &operator=(const ConstIterator &other) = default;
-
-        ConstIterator &operator=(ConstIterator &&other) noexcept = default;
+    using typename Base::Iterator;
+    using typename Base::ConstIterator;
+    using typename Base::InsertionResult;
 
-    private:
-        Iterator wrapped;
-    };
+    using Base::insert;
 
-    using value_type = KeyValuePair;
-    using const_iterator = ConstIterator;
-
-    HashMap() {
-        buckets = nullptr;
-        entries = nullptr;
-        capacity = usedEntriesAmount = deletedEntriesAmount = 0;
-        deletedList = -1;
-    }
+    HashMap() = default;
 
     HashMap(std::initializer_list<KeyValuePair> values,
             const Hasher &hasher = Hasher(),
-            const KeyEqualComparer &keyEqualComparer = KeyEqualComparer()) : hasher(hasher), keyEqualComparer(keyEqualComparer) {
-        buckets = nullptr;
-        entries = nullptr;
-        capacity = usedEntriesAmount = deletedEntriesAmount = 0;
-        deletedList = -1;
-
+            const KeyEqualComparer &keyEqualComparer = KeyEqualComparer()) : Base(hasher, keyEqualComparer) {
         for (const auto &kvp : values) {
             insert(kvp);
         }
     }
 
-    HashMap(const HashMap &other) {
-        buckets = nullptr;
-        entries = nullptr;
-        capacity = usedEntriesAmount = deletedEntriesAmount = 0;
-        deletedList = -1;
-
-        for (const auto &kvp : other) {
-            insert(kvp);
-        }
+    explicit HashMap(const HashMapOptions &options,
+                     const Hasher &hasher = Hasher(),
+                     const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : Base(hasher, keyEqualComparer, options) {
     }
 
-    HashMap(HashMap &&other) noexcept {
-        buckets = nullptr;
-        entries = nullptr;
-        capacity = usedEntriesAmount = deletedEntriesAmount = 0;
-        deletedList = -1;
+    HashMap(const HashMap &other) = default;
 
-        MoveFrom(other);
-    }
+    HashMap(HashMap &&other) = default;
 
-    ~HashMap() {
-        clear();
-    }
+    ~HashMap() = default;
 
-    [[nodiscard]] size_t size() const {
-        return usedEntriesAmount - deletedEntriesAmount;
-    }
+    HashMap &operator=(const HashMap &other) = default;
 
-    void clear() {
-        delete[] buckets;
-        delete[] entries;
-        buckets = nullptr;
-        entries = nullptr;
-        capacity = usedEntriesAmount = deletedEntriesAmount = 0;
-        deletedList = -1;
-    }
+    HashMap &operator=(HashMap &&other) = default;
 
     InsertionResult insert(const KeyValuePair &item) {
         return insert(KeyValuePair(item));
@@ -198,378 +55,210 @@ public:
 
     InsertionResult insert(TKey &&key, TValue &&value) {
         const auto hash = std::invoke(hasher, key);
-        const auto existing = TryFindEntryIndex(key, hash);
-
-        if (existing != -1) {
-            return std::make_pair(false, end());
-        }
 
-        const auto createdEntryIndex = CreateAndGetEntryIndex(
-            hash, std::forward<TKey>(key), std::forward<TValue>(value));
-
-        return std::make_pair(true, Iterator(this, createdEntryIndex));
+        return EmplaceUnique(key, hash, std::piecewise_construct,
+                             std::forward_as_tuple(std::forward<TKey>(key)),
+                             std::forward_as_tuple(std::forward<TValue>(value)));
     }
 
     InsertionResult insert(KeyValuePair &&item) {
         const auto hash = std::invoke(hasher, item.first);
-        const auto existing = TryFindEntryIndex(item.first, hash);
 
-        if (existing != -1) {
-            return std::make_pair(false, end());
-        }
-
-        const auto createdEntryIndex = CreateAndGetEntryIndex(std::forward<KeyValuePair>(item), hash);
-
-        return std::make_pair(true, Iterator(this, createdEntryIndex));
+        return EmplaceUnique(item.first, hash, std::forward<KeyValuePair>(item));
     }
 
+    // The key is copied only if the pair is created.
     template <class...Args>
     InsertionResult try_emplace(const TKey &key, Args&&... args) {
-        return try_emplace(TKey(key), std::forward<Args>(args)...);
+        const auto hash = std::invoke(hasher, key);
+
+        return EmplaceUnique(key, hash, std::piecewise_construct,
+                             std::forward_as_tuple(key),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
     }
 
     template <class...Args>
     InsertionResult try_emplace(TKey&& key, Args&&... args) {
         const auto hash = std::invoke(hasher, key);
-        const auto existing = TryFindEntryIndex(key, hash);
-
-        if (existing != -1) {
-            return std::make_pair(false, end());
-        }
 
-        const auto createdEntryIndex = CreateAndGetEntryIndex(
-            hash, std::forward<TKey>(key), std::forward<Args>(args)...);
-
-        return std::make_pair(true, Iterator(this, createdEntryIndex));
+        return EmplaceUnique(key, hash, std::piecewise_construct,
+                             std::forward_as_tuple(std::forward<TKey>(key)),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
     }
 
-    TValue &operator[](const TKey &key) {
-        const auto hash = std::invoke(hasher, key);
-        const auto existingIndex = TryFindEntryIndex(key, hash);
-
-        if (existingIndex != -1) {
-            return entries[existingIndex].kvp->second;
-        }
+    // Assigns the value if the key is present, inserts the pair otherwise; the key is hashed once.
+    template <class TMapped>
+    InsertionResult insert_or_assign(const TKey &key, TMapped &&value) {
+        return InsertOrAssign(key, std::forward<TMapped>(value));
+    }
 
-        const auto createdIndex = CreateAndGetEntryIndex(hash, TKey(key), TValue());
+    template <class TMapped>
+    InsertionResult insert_or_assign(TKey &&key, TMapped &&value) {
+        return InsertOrAssign(std::move(key), std::forward<TMapped>(value));
+    }
 
-        return entries[createdIndex].kvp->second;
+    // Calls update(value) if the key is present, constructs the value from `args` otherwise.
+    template <class Update, class...Args>
+    TValue &emplace_or_update(const TKey &key, Update update, Args&&... args) {
+        return EmplaceOrUpdate(key, std::invoke(hasher, key), update, std::forward<Args>(args)...);
     }
 
-    TValue &operator[](TKey &&key) {
+    template <class Update, class...Args>
+    TValue &emplace_or_update(TKey &&key, Update update, Args&&... args) {
         const auto hash = std::invoke(hasher, key);
-        const auto existingIndex = TryFindEntryIndex(key, hash);
 
-        if (existingIndex != -1) {
-            return entries[existingIndex].kvp->second;
-        }
-
-        const auto createdIndex = CreateAndGetEntryIndex(hash, std::forward<TKey>(key), TValue());
-
-        return entries[createdIndex].kvp->second;
+        return EmplaceOrUpdate(std::move(key), hash, update, std::forward<Args>(args)...);
     }
 
-    Iterator erase(Iterator position) {
-        const auto entryIndex = position.GetEntryIndex();
-        auto bucket = static_cast<int>(entries[entryIndex].hash % capacity);
-        const auto previousIndex = FindPreviousIndexOf(bucket, entryIndex);
-
-        if (previousIndex != -1) {
-            entries[previousIndex].next = entries[entryIndex].next;
-        } else {
-            buckets[bucket] = entries[entryIndex].next;
-        }
-
-        const auto next = entries[entryIndex].next;
+    // The same with the key hashed beforehand by the hasher of the map, as in insert_bulk.
+    template <class Update, class...Args>
+    TValue &emplace_or_update_with_hash(const TKey &key, size_t hash, Update update, Args&&... args) {
+        return EmplaceOrUpdate(key, hash, update, std::forward<Args>(args)...);
+    }
 
-        delete entries[entryIndex].kvp;
-        entries[entryIndex].kvp = nullptr;
-        entries[entryIndex].next = deletedList;
-        deletedList = entryIndex;
-        deletedEntriesAmount++;
+    // Calls fn(value, existed) on the value of the key, value-initialized first if the key is absent.
+    // The pair stays if fn returns true and is removed otherwise; returns its position or end().
+    template <class Function>
+    Iterator compute(const TKey &key, Function fn) {
+        const auto hash = std::invoke(hasher, key);
+        auto index = TryFindEntryIndex(key, hash);
+        const auto existed = index != -1;
 
-        if (next != -1) {
-            return Iterator(this, next);
+        if (!existed) {
+            index = CreateAndGetEntryIndex(
+                hash, std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>());
         }
 
-        while (++bucket < capacity && buckets[bucket] == -1) {
-            ;
+        if (std::invoke(fn, entries[index].node->second, existed)) {
+            return Iterator(this, index);
         }
 
-        if (bucket < capacity) {
-            return Iterator(this, buckets[bucket]);
-        }
+        this->DestroyNode(this->DetachEntry(static_cast<int>(hash % this->capacity), index));
 
-        return end();
+        return this->end();
     }
 
-    Iterator find(const TKey &key) {
-        auto index = TryFindEntryIndex(key, std::invoke(hasher, key));
-
-        return index != -1 ? Iterator(this, index) : end();
-    }
+    // Inserts a batch of pairs whose keys were hashed beforehand, pairs with keys already present are dropped.
+    // The table is grown for the whole batch up front. Pairs are then linked in groups: bucket heads of a group
+    // are prefetched first and the entries they point to next, so the cache misses of a group overlap instead
+    // of stalling every insert in turn. Equal keys keep their order, the first one wins.
+    // Returns how many pairs were inserted.
+    size_t insert_bulk(std::vector<std::pair<TKey, TValue>> &&items, const std::vector<size_t> &hashes) {
+        // Growing by at least the usual factor keeps a stream of batches from rehashing on every one of them.
+        const auto required = this->size() + items.size();
 
-    ConstIterator find(const TKey &key) const {
-        auto nonConstUnwrapped = const_cast<HashMap *>(this);
+        if (required > this->capacity) {
+            this->reserve(std::max(required, PrimesHelper::ExpandPrime(this->capacity)));
+        }
 
-        return ConstIterator(nonConstUnwrapped->find(key));
-    }
+        size_t inserted = 0;
+        size_t groupBuckets[BulkGroupLength];
 
-    HashMap &operator=(const HashMap &other) {
-        if (&other != this) {
-            clear();
+        for (size_t first = 0; first < items.size(); first += BulkGroupLength) {
+            const auto length = std::min(BulkGroupLength, items.size() - first);
 
-            for (const auto &kvp : other) {
-                insert(kvp);
+            for (size_t i = 0; i < length; i++) {
+                groupBuckets[i] = hashes[first + i] % this->capacity;
+                this->Prefetch(&this->buckets[groupBuckets[i]]);
             }
-        }
-
-        return *this;
-    }
 
-    HashMap &operator=(HashMap &&other) noexcept {
-        if (&other != this) {
-            clear();
+            for (size_t i = 0; i < length; i++) {
+                const auto head = this->buckets[groupBuckets[i]];
 
-            MoveFrom(other);
-        }
-
-        return *this;
-    }
+                if (head >= 0) {
+                    this->Prefetch(&entries[head]);
+                }
+            }
 
-    Iterator begin() {
-        auto firstBucket = 0;
+            for (size_t i = 0; i < length; i++) {
+                auto &item = items[first + i];
 
-        while (firstBucket < capacity && buckets[firstBucket] == -1) {
-            firstBucket++;
+                if (TryFindEntryIndex(item.first, hashes[first + i]) == -1) {
+                    CreateAndGetEntryIndex(hashes[first + i], std::move(item));
+                    inserted++;
+                }
+            }
         }
 
-        return Iterator(this, firstBucket < capacity ? buckets[firstBucket] : -1);
-    }
-
-    Iterator end() {
-        return Iterator(this, -1);
+        return inserted;
     }
 
-    ConstIterator begin() const {
-        auto nonConstUnwrapped = const_cast<HashMap *>(this);
-
-        return ConstIterator(nonConstUnwrapped->begin());
-    }
-
-    ConstIterator end() const {
-        auto nonConstUnwrapped = const_cast<HashMap *>(this);
-
-        return ConstIterator(nonConstUnwrapped->end());
-    }
-
-    ConstIterator cbegin() const {
-        return begin();
+    // The key is copied only if the pair is created.
+    TValue &operator[](const TKey &key) {
+        return Subscript(key);
     }
 
-    ConstIterator cend() const {
-        return end();
+    TValue &operator[](TKey &&key) {
+        return Subscript(std::move(key));
     }
 
 private:
-    struct Entry {
-        Entry() {
-            hash = 0;
-            next = -1;
-            kvp = nullptr;
-        }
-
-        Entry(const Entry &other) = delete;
-
-        Entry(Entry &&other) noexcept {
-            hash = other.hash;
-            next = other.next;
-            kvp = other.kvp;
-            other.kvp = nullptr;
-        }
-
-        ~Entry() {
-            delete kvp;
-        }
-
-        Entry &operator=(const Entry &other) = delete;
-
-        Entry &operator=(Entry &&other) noexcept {
-            if (&other != this) {
-                hash = other.hash;
-                next = other.next;
+    static constexpr size_t BulkGroupLength = 16;
 
-                delete kvp;
-                kvp = other.kvp;
-                other.kvp = nullptr;
-            }
+    template <class K>
+    TValue &Subscript(K &&key) {
+        const auto hash = std::invoke(hasher, key);
+        const auto existingIndex = TryFindEntryIndex(key, hash);
 
-            return *this;
+        if (existingIndex != -1) {
+            return entries[existingIndex].node->second;
         }
 
-        size_t hash;
-        KeyValuePair *kvp;
-        int next;
-    };
-
-    Hasher hasher;
-    KeyEqualComparer keyEqualComparer;
-    int *buckets;
-    Entry *entries;
-    size_t capacity;
-    size_t usedEntriesAmount;
-    size_t deletedEntriesAmount;
-    int deletedList;
-
-    void Initialize(size_t size) {
-        capacity = PrimesHelper::GetPrime(size);
-
-        buckets = new int[capacity];
-        entries = new Entry[capacity];
-
-        std::memset(buckets, -1, sizeof(int) * capacity);
-    }
-
-    void MoveFrom(HashMap &&other) {
-        hasher = std::move(other.hasher);
-        keyEqualComparer = std::move(other.keyEqualComparer);
-
-        usedEntriesAmount = other.usedEntriesAmount;
-        deletedEntriesAmount = other.deletedEntriesAmount;
-        deletedList = other.deletedList;
-
-        buckets = other.buckets;
-        entries = other.entries;
-        capacity = other.capacity;
-
-        other.buckets = other.entries = nullptr;
-        other.usedEntriesAmount = other.deletedEntriesAmount = other.capacity = 0;
-        other.deletedList = -1;
-    }
+        const auto createdIndex = CreateAndGetEntryIndex(
+            hash, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::tuple<>());
 
-    int CreateAndGetEntryIndex(KeyValuePair &&pair, size_t hash) {
-        auto [bucket, index] = GetNextCreationBucketAndIndex(hash);
-
-        entries[index].hash = hash;
-        entries[index].kvp = new KeyValuePair(std::forward<KeyValuePair>(pair));
-        entries[index].next = buckets[bucket];
-
-        buckets[bucket] = index;
-
-        return index;
+        return entries[createdIndex].node->second;
     }
 
-    template <class...Args>
-    int CreateAndGetEntryIndex(size_t hash, TKey &&key, Args&&... args) {
-        auto [bucket, index] = GetNextCreationBucketAndIndex(hash);
-
-        entries[index].hash = hash;
-        entries[index].kvp = new KeyValuePair(
-            std::piecewise_construct,
-            std::make_tuple(std::forward<TKey>(key)),
-            std::make_tuple(std::forward<Args>(args)...));
-        entries[index].next = buckets[bucket];
+    using Base::hasher;
+    using Base::entries;
+    using Base::EmplaceUnique;
+    using Base::TryFindEntryIndex;
+    using Base::CreateAndGetEntryIndex;
 
-        buckets[bucket] = index;
+    template <class TKeyArgument, class TMapped>
+    InsertionResult InsertOrAssign(TKeyArgument &&key, TMapped &&value) {
+        const auto hash = std::invoke(hasher, key);
+        const auto existingIndex = TryFindEntryIndex(key, hash);
 
-        return index;
-    }
+        if (existingIndex != -1) {
+            entries[existingIndex].node->second = std::forward<TMapped>(value);
 
-    std::pair<int, int> GetNextCreationBucketAndIndex(size_t hash) {
-        if (capacity == 0) {
-            Initialize(0);
+            return std::make_pair(false, Iterator(this, existingIndex));
         }
 
-        int index;
-        auto bucket = static_cast<int>(hash % capacity);
-
-        if (deletedEntriesAmount > 0) {
-            index = deletedList;
-            deletedList = entries[deletedList].next;
-            deletedEntriesAmount--;
-        } else {
-            if (usedEntriesAmount == capacity) {
-                Enlarge();
-                bucket = static_cast<int>(hash % capacity);
-            }
-
-            index = static_cast<int>(usedEntriesAmount++);
-        }
+        const auto createdIndex = CreateAndGetEntryIndex(
+            hash, std::piecewise_construct, std::forward_as_tuple(std::forward<TKeyArgument>(key)),
+            std::forward_as_tuple(std::forward<TMapped>(value)));
 
-        return std::make_pair(bucket, index);
+        return std::make_pair(true, Iterator(this, createdIndex));
     }
 
-    int TryFindEntryIndex(const TKey &key, size_t hash) {
-        if (capacity == 0) {
-            return -1;
-        }
-
-        auto current = static_cast<int>(buckets[hash % capacity]);
-
-        while (current >= 0) {
-            auto &entry = entries[current];
-
-            if (hash == entry.hash && std::invoke(keyEqualComparer, key, entry.kvp->first)) {
-                return current;
-            }
-
-            current = entry.next;
-        }
-
-        return current;
-    }
+    template <class TKeyArgument, class Update, class...Args>
+    TValue &EmplaceOrUpdate(TKeyArgument &&key, size_t hash, Update &update, Args&&... args) {
+        const auto existingIndex = TryFindEntryIndex(key, hash);
 
-    void Enlarge() {
-        const auto oldCapacity = capacity;
-        capacity = PrimesHelper::ExpandPrime(capacity);
+        if (existingIndex != -1) {
+            auto &value = entries[existingIndex].node->second;
+            std::invoke(update, value);
 
-        if (capacity <= oldCapacity) {
-            // unreachable
-            return;
+            return value;
         }
 
-        auto *newBuckets = new int[capacity];
-        auto *newEntries = new Entry[capacity];
-
-        std::memset(newBuckets, -1, sizeof(int) * capacity);
-
-        for (size_t i = 0; i < oldCapacity; i++) {
-            newEntries[i] = std::move(entries[i]);
-
-            if (newEntries[i].kvp != nullptr) {
-                const auto newBucket = static_cast<int>(newEntries[i].hash % capacity);
-                newEntries[i].next = newBuckets[newBucket];
-                newBuckets[newBucket] = static_cast<int>(i);
-            }
-        }
+        const auto createdIndex = CreateAndGetEntryIndex(
+            hash, std::piecewise_construct, std::forward_as_tuple(std::forward<TKeyArgument>(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...));
 
-        delete[] entries;
-        delete[] buckets;
-        buckets = newBuckets;
-        entries = newEntries;
+        return entries[createdIndex].node->second;
     }
+};
 
-    int FindPreviousIndexOf(int bucket, int entryIndex) {
-        if (capacity == 0) {
-            return -1;
-        }
-
-        const auto &key = entries[entryIndex].kvp->first;
-        const auto keyHash = entries[entryIndex].hash;
-        auto current = buckets[bucket];
-        auto previous = -1;
-
-        while (current < capacity) {
-            auto &entry = entries[current];
-
-            if (entry.hash == keyHash && std::invoke(keyEqualComparer, entry.kvp->first, key)) {
-                break;
-            }
-
-            previous = current;
-            current = entries[current].next;
-        }
+// Keeps up to InlineCapacity pairs inside the map object and allocates only once it grows past them.
+// Every inline slot costs a bucket, an entry and a pair whether it is used or not, so InlineCapacity should be
+// close to the usual size of the map: far larger, and the object outweighs a HashMap that allocates.
+template<class TKey, class TValue, size_t InlineCapacity = 8, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+using SmallHashMap = HashMap<TKey, TValue, Hasher, KeyEqualComparer, InlineCapacity>;
 
-        return previous;
-    }
-};
+// Walks chains over a dense array of hash tags and links, for large maps probed mostly for absent keys.
+template<class TKey, class TValue, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+using SplitHashMap = HashMap<TKey, TValue, Hasher, KeyEqualComparer, 0, EntryLayout::Split>;
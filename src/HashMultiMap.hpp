@@ -0,0 +1,398 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "HashTable.hpp"
+
+namespace MultiMapDetails {
+    template <class TValue, size_t Length>
+    struct ValueChunk {
+        alignas(TValue) unsigned char storage[sizeof(TValue) * Length];
+        int next = -1;
+        size_t size = 0;
+
+        TValue *Values() {
+            return std::launder(reinterpret_cast<TValue *>(storage));
+        }
+    };
+
+    // The first chunk lives inside the node next to the key, further ones are taken from the pool.
+    template <class TKey, class TChunk>
+    struct ValueGroup {
+        explicit ValueGroup(TKey &&key) : key(std::move(key)) {
+        }
+
+        const TKey key;
+        TChunk head;
+        int lastChunk = -1;
+        size_t count = 0;
+    };
+
+    struct KeyOfGroup {
+        template <class TGroup>
+        const auto &operator()(const TGroup &group) const {
+            return group.key;
+        }
+    };
+}
+
+// Keeps all values of a key in a list of fixed size chunks: the first one is stored in the key node,
+// the rest come from a pool shared by the whole map. Adding a value allocates at most once per ChunkLength
+// values and the values of a key are scanned sequentially.
+template<class TKey, class TValue, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>, size_t ChunkLength = 4>
+class HashMultiMap : private HashTable<TKey,
+                                       MultiMapDetails::ValueGroup<TKey, MultiMapDetails::ValueChunk<TValue, ChunkLength>>,
+                                       MultiMapDetails::KeyOfGroup, Hasher, KeyEqualComparer> {
+    using Chunk = MultiMapDetails::ValueChunk<TValue, ChunkLength>;
+    using Group = MultiMapDetails::ValueGroup<TKey, Chunk>;
+    using Base = HashTable<TKey, Group, MultiMapDetails::KeyOfGroup, Hasher, KeyEqualComparer>;
+
+    static_assert(ChunkLength > 0, "chunk must hold at least one value");
+
+public:
+    class ValueIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TValue;
+        using difference_type = std::ptrdiff_t;
+        using pointer = TValue *;
+        using reference = TValue &;
+
+        ValueIterator() : chunks(nullptr), chunk(nullptr), position(0) {
+        }
+
+        ValueIterator(std::deque<Chunk> *chunks, Chunk *chunk) : chunks(chunks), chunk(chunk), position(0) {
+            if (chunk->size == 0) {
+                this->chunk = nullptr;
+            }
+        }
+
+        TValue &operator*() const {
+            return chunk->Values()[position];
+        }
+
+        TValue *operator->() const {
+            return chunk->Values() + position;
+        }
+
+        ValueIterator &operator++() {
+            if (++position == chunk->size) {
+                chunk = chunk->next != -1 ? &(*chunks)[chunk->next] : nullptr;
+                position = 0;
+            }
+
+            return *this;
+        }
+
+        ValueIterator operator++(int) {
+            auto previous = *this;
+            ++*this;
+
+            return previous;
+        }
+
+        bool operator==(const ValueIterator &other) const {
+            return chunk == other.chunk && position == other.position;
+        }
+
+        bool operator!=(const ValueIterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        std::deque<Chunk> *chunks;
+        Chunk *chunk;
+        size_t position;
+    };
+
+    class ValueRange {
+    public:
+        ValueRange(ValueIterator first, size_t count) : first(first), count(count) {
+        }
+
+        ValueIterator begin() const {
+            return first;
+        }
+
+        ValueIterator end() const {
+            return ValueIterator();
+        }
+
+        [[nodiscard]] size_t size() const {
+            return count;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return count == 0;
+        }
+
+    private:
+        ValueIterator first;
+        size_t count;
+    };
+
+    using key_type = TKey;
+    using mapped_type = TValue;
+
+    explicit HashMultiMap(const Hasher &hasher = Hasher(),
+                          const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : Base(hasher, keyEqualComparer) {
+        valuesAmount = 0;
+        freeChunkList = -1;
+    }
+
+    HashMultiMap(const HashMultiMap &other) : Base(other.hasher, other.keyEqualComparer, other.get_options()) {
+        valuesAmount = 0;
+        freeChunkList = -1;
+
+        CopyValuesFrom(other);
+    }
+
+    HashMultiMap(HashMultiMap &&other) noexcept
+        : Base(std::move(other)), chunks(std::move(other.chunks)) {
+        valuesAmount = other.valuesAmount;
+        freeChunkList = other.freeChunkList;
+
+        other.valuesAmount = 0;
+        other.freeChunkList = -1;
+    }
+
+    ~HashMultiMap() {
+        DestroyValues();
+    }
+
+    HashMultiMap &operator=(const HashMultiMap &other) {
+        if (&other != this) {
+            clear();
+            CopyValuesFrom(other);
+        }
+
+        return *this;
+    }
+
+    HashMultiMap &operator=(HashMultiMap &&other) noexcept {
+        if (&other != this) {
+            clear();
+
+            Base::operator=(std::move(other));
+            chunks = std::move(other.chunks);
+            valuesAmount = other.valuesAmount;
+            freeChunkList = other.freeChunkList;
+
+            other.chunks.clear();
+            other.valuesAmount = 0;
+            other.freeChunkList = -1;
+        }
+
+        return *this;
+    }
+
+    // Number of stored values over all keys.
+    [[nodiscard]] size_t size() const {
+        return valuesAmount;
+    }
+
+    [[nodiscard]] size_t keys_count() const {
+        return Base::size();
+    }
+
+    void clear() {
+        DestroyValues();
+        Base::clear();
+        chunks.clear();
+        valuesAmount = 0;
+        freeChunkList = -1;
+    }
+
+    // A value whose constructor throws leaves neither an empty chunk nor an empty group behind.
+    template <class...Args>
+    TValue &emplace(const TKey &key, Args&&... args) {
+        bool created;
+        auto &group = FindOrCreateGroup(key, created);
+        auto *last = group.lastChunk != -1 ? &chunks[group.lastChunk] : &group.head;
+        auto acquired = -1;
+
+        if (last->size == ChunkLength) {
+            acquired = AcquireChunk();
+        }
+
+        auto &chunk = acquired != -1 ? chunks[acquired] : *last;
+        TValue *value;
+
+        try {
+            value = new (chunk.Values() + chunk.size) TValue(std::forward<Args>(args)...);
+        } catch (...) {
+            if (acquired != -1) {
+                chunk.next = freeChunkList;
+                freeChunkList = acquired;
+            }
+
+            if (created) {
+                Base::erase(key);
+            }
+
+            throw;
+        }
+
+        if (acquired != -1) {
+            last->next = acquired;
+            group.lastChunk = acquired;
+        }
+
+        chunk.size++;
+        group.count++;
+        valuesAmount++;
+
+        return *value;
+    }
+
+    TValue &insert(const TKey &key, const TValue &value) {
+        return emplace(key, value);
+    }
+
+    TValue &insert(const TKey &key, TValue &&value) {
+        return emplace(key, std::move(value));
+    }
+
+    [[nodiscard]] size_t count(const TKey &key) const {
+        const auto *group = FindGroup(key);
+
+        return group != nullptr ? group->count : 0;
+    }
+
+    bool contains(const TKey &key) const {
+        return FindGroup(key) != nullptr;
+    }
+
+    // Values of the key in insertion order.
+    ValueRange values(const TKey &key) {
+        auto *group = FindGroup(key);
+
+        if (group == nullptr) {
+            return ValueRange(ValueIterator(), 0);
+        }
+
+        return ValueRange(ValueIterator(&chunks, &group->head), group->count);
+    }
+
+    std::pair<ValueIterator, ValueIterator> equal_range(const TKey &key) {
+        const auto range = values(key);
+
+        return std::make_pair(range.begin(), range.end());
+    }
+
+    // Removes the key with all its values, returns the number of removed values.
+    size_t erase(const TKey &key) {
+        auto position = Base::find(key);
+
+        if (position == Base::end()) {
+            return 0;
+        }
+
+        const auto removed = position->count;
+
+        ReleaseChunks(*position);
+        Base::erase(position);
+        valuesAmount -= removed;
+
+        return removed;
+    }
+
+    // Calls fn(key, values) for every key.
+    template <class Function>
+    void for_each_key(Function fn) {
+        for (auto &group : static_cast<Base &>(*this)) {
+            std::invoke(fn, group.key, ValueRange(ValueIterator(&chunks, &group.head), group.count));
+        }
+    }
+
+private:
+    std::deque<Chunk> chunks;
+    size_t valuesAmount;
+    int freeChunkList;
+
+    Group *FindGroup(const TKey &key) {
+        const auto index = this->TryFindEntryIndex(key, std::invoke(this->hasher, key));
+
+        return index != -1 ? this->entries[index].node : nullptr;
+    }
+
+    const Group *FindGroup(const TKey &key) const {
+        auto nonConstUnwrapped = const_cast<HashMultiMap *>(this);
+        const auto index = nonConstUnwrapped->TryFindEntryIndex(key, std::invoke(this->hasher, key));
+
+        return index != -1 ? this->entries[index].node : nullptr;
+    }
+
+    Group &FindOrCreateGroup(const TKey &key, bool &created) {
+        const auto hash = std::invoke(this->hasher, key);
+        auto index = this->TryFindEntryIndex(key, hash);
+
+        created = index == -1;
+
+        if (created) {
+            index = this->CreateAndGetEntryIndex(hash, TKey(key));
+        }
+
+        return *this->entries[index].node;
+    }
+
+    int AcquireChunk() {
+        if (freeChunkList != -1) {
+            const auto chunk = freeChunkList;
+            freeChunkList = chunks[chunk].next;
+            chunks[chunk].next = -1;
+
+            return chunk;
+        }
+
+        chunks.emplace_back();
+
+        return static_cast<int>(chunks.size() - 1);
+    }
+
+    // Destroys values of the group and returns its chunks to the pool.
+    void ReleaseChunks(Group &group) {
+        auto current = group.head.next;
+
+        std::destroy_n(group.head.Values(), group.head.size);
+        group.head.size = 0;
+        group.head.next = -1;
+
+        while (current != -1) {
+            auto &chunk = chunks[current];
+            const auto next = chunk.next;
+
+            std::destroy_n(chunk.Values(), chunk.size);
+            chunk.size = 0;
+            chunk.next = freeChunkList;
+            freeChunkList = current;
+
+            current = next;
+        }
+
+        group.lastChunk = -1;
+        group.count = 0;
+    }
+
+    void DestroyValues() {
+        for (auto &group : static_cast<Base &>(*this)) {
+            ReleaseChunks(group);
+        }
+    }
+
+    void CopyValuesFrom(const HashMultiMap &other) {
+        auto &source = const_cast<HashMultiMap &>(other);
+
+        source.for_each_key([this](const TKey &key, const ValueRange &range) {
+            for (const auto &value : range) {
+                emplace(key, value);
+            }
+        });
+    }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+
+#include "HashTable.hpp"
+
+// Stores keys alone, so every node is exactly one TKey.
+template<class TKey, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+class HashSet : public HashTable<TKey, const TKey, KeyOfItself, Hasher, KeyEqualComparer> {
+    using Base = HashTable<TKey, const TKey, KeyOfItself, Hasher, KeyEqualComparer>;
+
+public:
+    using typename Base::Iterator;
+    using typename Base::ConstIterator;
+    using typename Base::InsertionResult;
+
+    using Base::insert;
+
+    HashSet() = default;
+
+    HashSet(std::initializer_list<TKey> keys,
+            const Hasher &hasher = Hasher(),
+            const KeyEqualComparer &keyEqualComparer = KeyEqualComparer()) : Base(hasher, keyEqualComparer) {
+        for (const auto &key : keys) {
+            insert(key);
+        }
+    }
+
+    explicit HashSet(const HashMapOptions &options,
+                     const Hasher &hasher = Hasher(),
+                     const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : Base(hasher, keyEqualComparer, options) {
+    }
+
+    HashSet(const HashSet &other) = default;
+
+    HashSet(HashSet &&other) = default;
+
+    ~HashSet() = default;
+
+    HashSet &operator=(const HashSet &other) = default;
+
+    HashSet &operator=(HashSet &&other) = default;
+
+    // The key is copied only if it is inserted.
+    InsertionResult insert(const TKey &key) {
+        const auto hash = std::invoke(hasher, key);
+
+        return EmplaceUnique(key, hash, key);
+    }
+
+    InsertionResult insert(TKey &&key) {
+        const auto hash = std::invoke(hasher, key);
+
+        return EmplaceUnique(key, hash, std::forward<TKey>(key));
+    }
+
+private:
+    using Base::hasher;
+    using Base::EmplaceUnique;
+};
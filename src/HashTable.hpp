@@ -0,0 +1,1498 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Parallel.hpp"
+#include "PrimesHelper.h"
+#include "TableMemory.hpp"
+
+struct HashMapOptions {
+    // Number of threads used to relink entries when the table grows.
+    size_t resizeThreadsCount = 1;
+
+    // Tables smaller than this are always resized by the calling thread.
+    size_t parallelResizeMinCapacity = 1 << 20;
+
+    // Entry arrays of at least this many bytes are mapped together with their buckets at huge page boundaries
+    // and advised to be backed by transparent huge pages. SIZE_MAX keeps every table on the regular allocator.
+    size_t hugePageMinBytes = 32 << 20;
+
+    // Placement of huge page mapped arrays, bit i of numaNodeMask stands for the node i.
+    NumaPolicy numaPolicy = NumaPolicy::Default;
+    unsigned long numaNodeMask = 0;
+
+    // A chain growing past this length is kept sorted by key with a side array of its entries, so lookups in it
+    // take O(log n) key comparisons whatever the hasher does. Applies to keys with operator< compared by
+    // std::equal_to. Off by default (SIZE_MAX), maps hashing untrusted keys opt in, 32 is a sound length.
+    size_t sortedChainMinLength = SIZE_MAX;
+
+    bool operator==(const HashMapOptions &other) const = default;
+};
+
+struct KeyOfPair {
+    template <class TPair>
+    const auto &operator()(const TPair &pair) const {
+        return pair.first;
+    }
+};
+
+struct KeyOfItself {
+    template <class TKey>
+    const TKey &operator()(const TKey &key) const {
+        return key;
+    }
+};
+
+// Where the chain links of entries are stored.
+enum class EntryLayout {
+    // Hash, node pointer and chain link of an entry share one 24 byte record.
+    Interleaved,
+    // Chain links with 32 bit hash tags form their own dense array of 8 byte records, so a chain walk
+    // loads hash and node pointer only on a tag match. Misses touch a third of the memory, hits one line more.
+    Split,
+};
+
+// Buckets, entries and nodes of a table holding at most Capacity elements, kept inside the table object.
+template <class TEntry, class TNode, size_t Capacity>
+struct InlineTableStorage {
+    int buckets[Capacity];
+    TEntry entries[Capacity];
+    alignas(TNode) unsigned char nodes[sizeof(TNode) * Capacity];
+};
+
+template <class TEntry, class TNode>
+struct InlineTableStorage<TEntry, TNode, 0> {
+};
+
+// Bucket and entry engine shared by HashMap and HashSet.
+// Every stored node is allocated separately and referenced from an entry, entries are chained
+// by indices starting from buckets, erased entries are reused through the deleted list.
+// With InlineCapacity > 0 the first InlineCapacity elements live inside the table itself and nothing is
+// allocated until the table outgrows them; nodes are then moved to the heap, which copies const keys.
+template<class TKey, class TNode, class KeyOf, class Hasher, class KeyEqualComparer, size_t InlineCapacity = 0,
+         EntryLayout Layout = EntryLayout::Interleaved>
+class HashTable {
+    static_assert(InlineCapacity == 0 || Layout == EntryLayout::Interleaved,
+                  "split entries only pay off for tables far larger than the inline storage");
+
+public:
+    class Iterator;
+
+    using InsertionResult = std::pair<bool, Iterator>;
+
+    class Iterator {
+    public:
+        Iterator(HashTable *table, int entry) : table(table) {
+            currentEntryIndex = entry;
+
+            if (entry != -1) {
+                currentBucketIndex = static_cast<int>(table->entries[currentEntryIndex].hash % table->capacity);
+            } else {
+                currentBucketIndex = -1;
+            }
+        }
+
+        Iterator(const Iterator &other) = default;
+
+        Iterator(Iterator &&other) noexcept = default;
+
+        TNode &operator*() const {
+            return *table->entries[currentEntryIndex].node;
+        }
+
+        TNode *operator->() const {
+            return table->entries[currentEntryIndex].node;
+        }
+
+        Iterator &operator++() {
+            if (currentEntryIndex == -1) {
+                return *this;
+            }
+
+            if (table->LinkOf(currentEntryIndex).next != -1) {
+                currentEntryIndex = table->LinkOf(currentEntryIndex).next;
+            } else {
+                currentBucketIndex++;
+                const auto capacity = static_cast<int>(table->capacity);
+
+                while (currentBucketIndex < capacity && table->buckets[currentBucketIndex] == -1) {
+                    currentBucketIndex++;
+                }
+
+                if (currentBucketIndex < capacity) {
+                    currentEntryIndex = table->buckets[currentBucketIndex];
+                } else {
+                    currentEntryIndex = -1;
+                }
+            }
+
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto previous = *this;
+            ++*this;
+
+            return previous;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return currentEntryIndex == other.currentEntryIndex;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return currentEntryIndex != other.currentEntryIndex;
+        }
+
+        Iterator &operator=(const Iterator &other) = default;
+
+        Iterator &operator=(Iterator &&other) noexcept = default;
+
+        [[nodiscard]] int GetEntryIndex() const {
+            return currentEntryIndex;
+        }
+
+    private:
+        HashTable *table;
+        int currentBucketIndex;
+        int currentEntryIndex;
+    };
+
+    class ConstIterator {
+    public:
+        explicit ConstIterator(Iterator wrapped) : wrapped(wrapped) {
+        }
+
+        ConstIterator(const ConstIterator &other) = default;
+
+        ConstIterator(ConstIterator &&other) noexcept = default;
+
+        const TNode &operator*() const {
+            return wrapped.operator*();
+        }
+
+        const TNode *operator->() const {
+            return wrapped.operator->();
+        }
+
+        ConstIterator &operator++() {
+            ++wrapped;
+
+            return *this;
+        }
+
+        ConstIterator operator++(int) {
+            return ConstIterator(wrapped++);
+        }
+
+        bool operator==(const ConstIterator &other) const {
+            return wrapped == other.wrapped;
+        }
+
+        bool operator!=(const ConstIterator &other) const {
+            return wrapped != other.wrapped;
+        }
+
+        ConstIterator &operator=(const ConstIterator &other) = default;
+
+        ConstIterator &operator=(ConstIterator &&other) noexcept = default;
+
+    private:
+        Iterator wrapped;
+    };
+
+    class Partition {
+    public:
+        class Iterator {
+        public:
+            Iterator(HashTable *table, size_t entry, size_t last) : table(table), currentEntryIndex(entry), lastEntryIndex(last) {
+                SkipDeleted();
+            }
+
+            TNode &operator*() const {
+                return *table->entries[currentEntryIndex].node;
+            }
+
+            TNode *operator->() const {
+                return table->entries[currentEntryIndex].node;
+            }
+
+            Iterator &operator++() {
+                currentEntryIndex++;
+                SkipDeleted();
+
+                return *this;
+            }
+
+            bool operator==(const Iterator &other) const {
+                return currentEntryIndex == other.currentEntryIndex;
+            }
+
+            bool operator!=(const Iterator &other) const {
+                return currentEntryIndex != other.currentEntryIndex;
+            }
+
+        private:
+            HashTable *table;
+            size_t currentEntryIndex;
+            size_t lastEntryIndex;
+
+            void SkipDeleted() {
+                while (currentEntryIndex < lastEntryIndex && table->entries[currentEntryIndex].node == nullptr) {
+                    currentEntryIndex++;
+                }
+            }
+        };
+
+        Partition(HashTable *table, size_t first, size_t last) : table(table), firstEntryIndex(first), lastEntryIndex(last) {
+        }
+
+        Iterator begin() const {
+            return Iterator(table, firstEntryIndex, lastEntryIndex);
+        }
+
+        Iterator end() const {
+            return Iterator(table, lastEntryIndex, lastEntryIndex);
+        }
+
+    private:
+        HashTable *table;
+        size_t firstEntryIndex;
+        size_t lastEntryIndex;
+    };
+
+    class NodeHandle {
+    public:
+        NodeHandle() : node(nullptr), hash(0) {
+        }
+
+        NodeHandle(const NodeHandle &other) = delete;
+
+        NodeHandle(NodeHandle &&other) noexcept : node(other.node), hash(other.hash) {
+            other.node = nullptr;
+        }
+
+        ~NodeHandle() {
+            delete node;
+        }
+
+        NodeHandle &operator=(const NodeHandle &other) = delete;
+
+        NodeHandle &operator=(NodeHandle &&other) noexcept {
+            if (&other != this) {
+                delete node;
+                node = other.node;
+                hash = other.hash;
+                other.node = nullptr;
+            }
+
+            return *this;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return node == nullptr;
+        }
+
+        explicit operator bool() const {
+            return node != nullptr;
+        }
+
+        const TKey &key() const {
+            return std::invoke(KeyOf(), *node);
+        }
+
+        auto &mapped() const {
+            return node->second;
+        }
+
+        TNode &value() const {
+            return *node;
+        }
+
+    private:
+        friend class HashTable;
+
+        NodeHandle(TNode *node, size_t hash) : node(node), hash(hash) {
+        }
+
+        TNode *Release() {
+            auto *released = node;
+            node = nullptr;
+
+            return released;
+        }
+
+        TNode *node;
+        size_t hash;
+    };
+
+    struct NodeInsertionResult {
+        Iterator position;
+        bool inserted;
+        NodeHandle node;
+    };
+
+    using key_type = TKey;
+    using value_type = TNode;
+    using const_iterator = ConstIterator;
+    using node_type = NodeHandle;
+    using insert_return_type = NodeInsertionResult;
+
+    [[nodiscard]] const HashMapOptions &get_options() const {
+        return customOptions != nullptr ? *customOptions : DefaultOptions();
+    }
+
+    void set_options(const HashMapOptions &newOptions) {
+        customOptions = newOptions == DefaultOptions() ? nullptr : std::make_unique<HashMapOptions>(newOptions);
+    }
+
+    [[nodiscard]] size_t size() const {
+        return usedEntriesAmount - deletedEntriesAmount;
+    }
+
+    [[nodiscard]] size_t bucket_count() const {
+        return capacity;
+    }
+
+    // Length of the chain starting at the bucket, tells how well the hasher spreads keys.
+    [[nodiscard]] size_t bucket_size(size_t bucket) const {
+        size_t length = 0;
+
+        for (auto current = buckets[bucket]; current >= 0; current = LinkOf(current).next) {
+            length++;
+        }
+
+        return length;
+    }
+
+    // Heap bytes of the arrays, nodes and sorted chains; memory owned by keys and values themselves is not counted.
+    [[nodiscard]] size_t memory_usage() const {
+        auto bytes = SortedChainsBytes();
+
+        if (!IsInline()) {
+            bytes += capacity * (sizeof(int) + sizeof(Entry) + (SplitLayout ? sizeof(Link) : 0)) + size() * sizeof(TNode);
+        }
+
+        return bytes;
+    }
+
+    [[nodiscard]] const Hasher &hash_function() const {
+        return hasher;
+    }
+
+    // Grows the table so that `count` elements fit without further resizes.
+    void reserve(size_t count) {
+        if (capacity == 0) {
+            Initialize(count);
+        } else if (count > capacity) {
+            Rehash(PrimesHelper::GetPrime(count));
+        }
+    }
+
+    void clear() {
+        DestroyNodes();
+
+        if (capacity > 0 && !IsInline()) {
+            ReleaseArrays(Arrays{buckets, entries, links}, capacity, largeTable);
+        }
+
+        buckets = nullptr;
+        entries = nullptr;
+        links = nullptr;
+        capacity = usedEntriesAmount = deletedEntriesAmount = 0;
+        deletedList = -1;
+        largeTable = false;
+        sortedChains.reset();
+    }
+
+    Iterator erase(Iterator position) {
+        const auto entryIndex = position.GetEntryIndex();
+        auto bucket = static_cast<int>(entries[entryIndex].hash % capacity);
+        const auto next = LinkOf(entryIndex).next;
+
+        DestroyNode(DetachEntry(bucket, entryIndex));
+
+        if (next != -1) {
+            return Iterator(this, next);
+        }
+
+        while (++bucket < static_cast<int>(capacity) && buckets[bucket] == -1) {
+            ;
+        }
+
+        if (bucket < static_cast<int>(capacity)) {
+            return Iterator(this, buckets[bucket]);
+        }
+
+        return end();
+    }
+
+    size_t erase(const TKey &key) {
+        const auto hash = std::invoke(hasher, key);
+        const auto index = TryFindEntryIndex(key, hash);
+
+        if (index == -1) {
+            return 0;
+        }
+
+        DestroyNode(DetachEntry(static_cast<int>(hash % capacity), index));
+
+        return 1;
+    }
+
+    // Unlinks the node from the table without destroying it. If moving an inline node to the heap throws,
+    // the node stays in the table.
+    node_type extract(Iterator position) {
+        const auto entryIndex = position.GetEntryIndex();
+        const auto hash = entries[entryIndex].hash;
+        const auto bucket = static_cast<int>(hash % capacity);
+        auto *node = DetachEntry(bucket, entryIndex);
+
+        try {
+            return node_type(TakeNode(node), hash);
+        } catch (...) {
+            ReattachEntry(bucket, entryIndex, node);
+            throw;
+        }
+    }
+
+    node_type extract(const TKey &key) {
+        const auto index = TryFindEntryIndex(key, std::invoke(hasher, key));
+
+        return index != -1 ? extract(Iterator(this, index)) : node_type();
+    }
+
+    // Links an extracted node into the table reusing its cached hash.
+    // If the key is already present, or if linking throws, the node is left in the handle.
+    insert_return_type insert(node_type &&node) {
+        if (node.empty()) {
+            return {end(), false, node_type()};
+        }
+
+        const auto existing = TryFindEntryIndex(node.key(), node.hash);
+
+        if (existing != -1) {
+            return {Iterator(this, existing), false, std::move(node)};
+        }
+
+        const auto [createdEntryIndex, adopted] = LinkEntry(node.node, node.hash, true);
+
+        if (adopted) {
+            node.Release();
+        } else {
+            node = node_type();
+        }
+
+        return {Iterator(this, createdEntryIndex), true, node_type()};
+    }
+
+    // Moves every node whose key is absent here out of `source`; nodes are relinked, not copied.
+    // If linking a node throws, it goes back to `source`.
+    template <size_t SourceInlineCapacity, EntryLayout SourceLayout>
+    void merge(HashTable<TKey, TNode, KeyOf, Hasher, KeyEqualComparer, SourceInlineCapacity, SourceLayout> &source) {
+        if (static_cast<const void *>(&source) == this) {
+            return;
+        }
+
+        for (size_t i = 0; i < source.usedEntriesAmount; i++) {
+            auto &entry = source.entries[i];
+
+            if (entry.node == nullptr || TryFindEntryIndex(std::invoke(KeyOf(), *entry.node), entry.hash) != -1) {
+                continue;
+            }
+
+            const auto hash = entry.hash;
+            const auto bucket = static_cast<int>(hash % source.capacity);
+
+            // Growing the table is what may throw while nothing is moved yet, so it comes first.
+            MakeRoomForEntry();
+
+            auto *node = source.DetachEntry(bucket, static_cast<int>(i));
+            bool adopted;
+
+            try {
+                adopted = LinkEntry(node, hash, !source.IsInline()).second;
+            } catch (...) {
+                source.ReattachEntry(bucket, static_cast<int>(i), node);
+                throw;
+            }
+
+            if (!adopted) {
+                source.DestroyNode(node);
+            }
+        }
+    }
+
+    template <size_t SourceInlineCapacity, EntryLayout SourceLayout>
+    void merge(HashTable<TKey, TNode, KeyOf, Hasher, KeyEqualComparer, SourceInlineCapacity, SourceLayout> &&source) {
+        merge(source);
+    }
+
+    Iterator find(const TKey &key) {
+        auto index = TryFindEntryIndex(key, std::invoke(hasher, key));
+
+        return index != -1 ? Iterator(this, index) : end();
+    }
+
+    ConstIterator find(const TKey &key) const {
+        auto nonConstUnwrapped = const_cast<HashTable *>(this);
+
+        return ConstIterator(nonConstUnwrapped->find(key));
+    }
+
+    bool contains(const TKey &key) const {
+        auto nonConstUnwrapped = const_cast<HashTable *>(this);
+
+        return nonConstUnwrapped->TryFindEntryIndex(key, std::invoke(hasher, key)) != -1;
+    }
+
+    Iterator begin() {
+        size_t firstBucket = 0;
+
+        while (firstBucket < capacity && buckets[firstBucket] == -1) {
+            firstBucket++;
+        }
+
+        return Iterator(this, firstBucket < capacity ? buckets[firstBucket] : -1);
+    }
+
+    Iterator end() {
+        return Iterator(this, -1);
+    }
+
+    ConstIterator begin() const {
+        auto nonConstUnwrapped = const_cast<HashTable *>(this);
+
+        return ConstIterator(nonConstUnwrapped->begin());
+    }
+
+    ConstIterator end() const {
+        auto nonConstUnwrapped = const_cast<HashTable *>(this);
+
+        return ConstIterator(nonConstUnwrapped->end());
+    }
+
+    ConstIterator cbegin() const {
+        return begin();
+    }
+
+    ConstIterator cend() const {
+        return end();
+    }
+
+    // Splits entries into at most `count` disjoint ranges of roughly equal length.
+    // Partitions stay valid until the table is modified, so each one may be walked by its own thread.
+    std::vector<Partition> partition(size_t count) {
+        std::vector<Partition> partitions;
+
+        if (usedEntriesAmount == 0 || count == 0) {
+            return partitions;
+        }
+
+        count = std::min(count, (usedEntriesAmount + MinPartitionLength - 1) / MinPartitionLength);
+        const auto length = (usedEntriesAmount + count - 1) / count;
+
+        for (size_t first = 0; first < usedEntriesAmount; first += length) {
+            partitions.emplace_back(this, first, std::min(first + length, usedEntriesAmount));
+        }
+
+        return partitions;
+    }
+
+    template <class Function>
+    void parallel_for_each(Function fn, size_t threadsCount = std::thread::hardware_concurrency()) {
+        const auto partitions = partition(std::max<size_t>(threadsCount, 1));
+
+        Parallel::Run(partitions.size(), [&](size_t index) {
+            for (auto &node : partitions[index]) {
+                std::invoke(fn, node);
+            }
+        });
+    }
+
+    // Maps every node with `map` and folds the results with `combine`, which must be associative
+    // and commutative since nodes are visited in no particular order. `init` is combined exactly once.
+    template <class T, class Map, class Combine>
+    T parallel_reduce(T init, Map map, Combine combine, size_t threadsCount = std::thread::hardware_concurrency()) {
+        const auto partitions = partition(std::max<size_t>(threadsCount, 1));
+        std::vector<std::optional<T>> partials(partitions.size());
+
+        Parallel::Run(partitions.size(), [&](size_t index) {
+            auto &partial = partials[index];
+
+            for (auto &node : partitions[index]) {
+                if (partial.has_value()) {
+                    partial = std::invoke(combine, std::move(*partial), std::invoke(map, node));
+                } else {
+                    partial.emplace(std::invoke(map, node));
+                }
+            }
+        });
+
+        for (auto &partial : partials) {
+            if (partial.has_value()) {
+                init = std::invoke(combine, std::move(init), std::move(*partial));
+            }
+        }
+
+        return init;
+    }
+
+protected:
+    template <class, class, class, class, class, size_t, EntryLayout>
+    friend class HashTable;
+
+    static constexpr bool SplitLayout = Layout == EntryLayout::Split;
+
+    struct Link {
+        uint32_t tag = 0;
+        int next = -1;
+    };
+
+    struct NoLink {
+    };
+
+    // A plain record whatever the node is: entry arrays are allocated uninitialized, grown by copying
+    // or reallocating bytes and released without destructors. The table owns the nodes and only ever
+    // touches entries below usedEntriesAmount.
+    struct Entry {
+        size_t hash;
+        TNode *node;
+        [[no_unique_address]] std::conditional_t<SplitLayout, NoLink, Link> link;
+    };
+
+    static_assert(std::is_trivially_copyable_v<Entry> && std::is_trivially_destructible_v<Entry>);
+
+    // Entry indices of one chain in ascending key order, the chain is linked in the same order.
+    struct SortedChain {
+        int bucket;
+        std::vector<int> indices;
+    };
+
+    // The sorted order has to agree with the equality the table uses.
+    static constexpr bool CanSortChains = std::totally_ordered<TKey>
+                                          && (std::is_same_v<KeyEqualComparer, std::equal_to<TKey>>
+                                              || std::is_same_v<KeyEqualComparer, std::equal_to<>>);
+
+    struct Arrays {
+        int *buckets;
+        Entry *entries;
+        Link *links;
+    };
+
+    static constexpr size_t MinPartitionLength = 4096;
+
+    static const HashMapOptions &DefaultOptions() {
+        static const HashMapOptions defaults;
+
+        return defaults;
+    }
+
+    Hasher hasher;
+    KeyEqualComparer keyEqualComparer;
+    // Only tables with non-default options carry them, the rest share DefaultOptions().
+    std::unique_ptr<HashMapOptions> customOptions;
+    int *buckets;
+    Entry *entries;
+    // Chain links of the split layout, nullptr otherwise.
+    Link *links;
+    size_t capacity;
+    size_t usedEntriesAmount;
+    size_t deletedEntriesAmount;
+    int deletedList;
+    // Buckets and entries are huge page mappings rather than arrays from operator new[].
+    bool largeTable;
+    // Overlong chains ordered by bucket, nullptr unless the hasher let keys pile up in a few buckets.
+    std::unique_ptr<std::vector<SortedChain>> sortedChains;
+    [[no_unique_address]] InlineTableStorage<Entry, TNode, InlineCapacity> inlineStorage;
+
+    explicit HashTable(const Hasher &hasher = Hasher(),
+                       const KeyEqualComparer &keyEqualComparer = KeyEqualComparer(),
+                       const HashMapOptions &options = HashMapOptions())
+        : hasher(hasher), keyEqualComparer(keyEqualComparer) {
+        set_options(options);
+        buckets = nullptr;
+        entries = nullptr;
+        links = nullptr;
+        capacity = usedEntriesAmount = deletedEntriesAmount = 0;
+        deletedList = -1;
+        largeTable = false;
+    }
+
+    HashTable(const HashTable &other)
+        : hasher(other.hasher), keyEqualComparer(other.keyEqualComparer) {
+        set_options(other.get_options());
+        buckets = nullptr;
+        entries = nullptr;
+        links = nullptr;
+        capacity = usedEntriesAmount = deletedEntriesAmount = 0;
+        deletedList = -1;
+        largeTable = false;
+
+        CopyFrom(other);
+    }
+
+    // Nodes of inline tables are relocated one by one, which copies their const keys.
+    static constexpr bool NothrowMove = InlineCapacity == 0 || std::is_nothrow_move_constructible_v<TNode>;
+
+    HashTable(HashTable &&other) noexcept(NothrowMove) {
+        buckets = nullptr;
+        entries = nullptr;
+        links = nullptr;
+        capacity = usedEntriesAmount = deletedEntriesAmount = 0;
+        deletedList = -1;
+        largeTable = false;
+
+        MoveFrom(std::move(other));
+    }
+
+    ~HashTable() {
+        clear();
+    }
+
+    HashTable &operator=(const HashTable &other) {
+        if (&other != this) {
+            clear();
+
+            hasher = other.hasher;
+            keyEqualComparer = other.keyEqualComparer;
+            set_options(other.get_options());
+
+            CopyFrom(other);
+        }
+
+        return *this;
+    }
+
+    HashTable &operator=(HashTable &&other) noexcept(NothrowMove) {
+        if (&other != this) {
+            clear();
+
+            MoveFrom(std::move(other));
+        }
+
+        return *this;
+    }
+
+    const TKey &KeyOfNode(const Entry &entry) const {
+        return std::invoke(KeyOf(), *entry.node);
+    }
+
+    // Constructs a node from `args` unless a node with `key` is already present, which is returned instead.
+    template <class...Args>
+    InsertionResult EmplaceUnique(const TKey &key, size_t hash, Args&&... args) {
+        const auto existing = TryFindEntryIndex(key, hash);
+
+        if (existing != -1) {
+            return std::make_pair(false, Iterator(this, existing));
+        }
+
+        const auto createdEntryIndex = CreateAndGetEntryIndex(hash, std::forward<Args>(args)...);
+
+        return std::make_pair(true, Iterator(this, createdEntryIndex));
+    }
+
+    [[nodiscard]] bool IsInline() const {
+        if constexpr (InlineCapacity > 0) {
+            return entries == inlineStorage.entries;
+        } else {
+            return false;
+        }
+    }
+
+    void *InlineNodeAt(int index) {
+        if constexpr (InlineCapacity > 0) {
+            return inlineStorage.nodes + sizeof(TNode) * index;
+        } else {
+            return nullptr;
+        }
+    }
+
+    void DestroyNode(TNode *node) {
+        if (IsInline()) {
+            std::destroy_at(node);
+        } else {
+            delete node;
+        }
+    }
+
+    // Gives the caller ownership of a detached node, moving it to the heap if it lived inline; a node whose move
+    // may throw is copied, so it is intact if this throws.
+    TNode *TakeNode(TNode *node) {
+        if (!IsInline()) {
+            return node;
+        }
+
+        auto *taken = new TNode(std::move_if_noexcept(*node));
+        std::destroy_at(node);
+
+        return taken;
+    }
+
+    // Inline nodes without destructors need no walk at all.
+    void DestroyNodes() {
+        if (IsInline() && std::is_trivially_destructible_v<TNode>) {
+            return;
+        }
+
+        for (size_t i = 0; i < usedEntriesAmount; i++) {
+            if (entries[i].node != nullptr) {
+                DestroyNode(entries[i].node);
+            }
+        }
+    }
+
+    void Initialize(size_t size) {
+        if constexpr (InlineCapacity > 0) {
+            if (size <= InlineCapacity) {
+                capacity = InlineCapacity;
+                buckets = inlineStorage.buckets;
+                entries = inlineStorage.entries;
+                largeTable = false;
+
+                std::memset(buckets, -1, sizeof(int) * capacity);
+
+                return;
+            }
+        }
+
+        capacity = PrimesHelper::GetPrime(size);
+        largeTable = IsLarge(capacity);
+
+        UseArrays(AllocateArrays(capacity, largeTable));
+
+        std::memset(buckets, -1, sizeof(int) * capacity);
+    }
+
+    // Keys of `other` are known to be unique and its hashes are reused, so nodes are linked without lookups.
+    void CopyFrom(const HashTable &other) {
+        if (other.size() == 0) {
+            return;
+        }
+
+        Initialize(other.size());
+
+        for (size_t i = 0; i < other.usedEntriesAmount; i++) {
+            const auto &entry = other.entries[i];
+
+            if (entry.node != nullptr) {
+                CreateAndGetEntryIndex(entry.hash, *entry.node);
+            }
+        }
+    }
+
+    void MoveFrom(HashTable &&other) noexcept(NothrowMove) {
+        hasher = std::move(other.hasher);
+        keyEqualComparer = std::move(other.keyEqualComparer);
+        customOptions = std::move(other.customOptions);
+
+        if (other.IsInline()) {
+            // Inline nodes cannot change hands, so they are relocated one by one.
+            for (size_t i = 0; i < other.usedEntriesAmount; i++) {
+                const auto &entry = other.entries[i];
+
+                if (entry.node != nullptr) {
+                    CreateAndGetEntryIndex(entry.hash, std::move(*entry.node));
+                }
+            }
+
+            other.clear();
+
+            return;
+        }
+
+        usedEntriesAmount = other.usedEntriesAmount;
+        deletedEntriesAmount = other.deletedEntriesAmount;
+        deletedList = other.deletedList;
+
+        buckets = other.buckets;
+        entries = other.entries;
+        links = other.links;
+        capacity = other.capacity;
+        largeTable = other.largeTable;
+        sortedChains = std::move(other.sortedChains);
+
+        other.buckets = nullptr;
+        other.entries = nullptr;
+        other.links = nullptr;
+        other.largeTable = false;
+        other.usedEntriesAmount = other.deletedEntriesAmount = other.capacity = 0;
+        other.deletedList = -1;
+    }
+
+    // Makes sure the next entry is taken without growing the table.
+    void MakeRoomForEntry() {
+        if (capacity == 0) {
+            Initialize(0);
+        } else if (deletedEntriesAmount == 0 && usedEntriesAmount == capacity) {
+            Enlarge();
+        }
+    }
+
+    // Links a node the caller owns and keeps owning if this throws. A heap node is adopted as it is, unless
+    // nodes of this table live inline or `heapNode` is false; then it is moved into a node of the table, or
+    // copied if its move may throw, and the caller disposes of it. Returns the entry index and whether
+    // `node` was adopted.
+    std::pair<int, bool> LinkEntry(TNode *node, size_t hash, bool heapNode) {
+        MakeRoomForEntry();
+
+        auto *linked = node;
+
+        if (IsInline()) {
+            const auto next = deletedEntriesAmount > 0 ? deletedList : static_cast<int>(usedEntriesAmount);
+            linked = new (InlineNodeAt(next)) TNode(std::move_if_noexcept(*node));
+        } else if (!heapNode) {
+            linked = new TNode(std::move_if_noexcept(*node));
+        }
+
+        const auto [bucket, index] = GetNextCreationBucketAndIndex(hash);
+
+        entries[index].hash = hash;
+        entries[index].node = linked;
+        LinkIntoBucket(bucket, index);
+
+        return {index, linked == node};
+    }
+
+    // Undoes DetachEntry of the entry last detached: it is still at the head of the deleted list, and
+    // a sorted chain it left has room for it again.
+    void ReattachEntry(int bucket, int entryIndex, TNode *node) {
+        deletedList = LinkOf(entryIndex).next;
+        deletedEntriesAmount--;
+        entries[entryIndex].node = node;
+        LinkIntoBucket(bucket, entryIndex);
+    }
+
+    // Removes the entry from its chain, puts it to the deleted list and hands its node to the caller.
+    TNode *DetachEntry(int bucket, int entryIndex) {
+        auto previousIndex = -1;
+
+        if constexpr (CanSortChains) {
+            auto *chain = FindSortedChain(bucket);
+
+            previousIndex = chain != nullptr ? RemoveFromSortedChain(*chain, entryIndex)
+                                             : FindPreviousIndexOf(bucket, entryIndex);
+        } else {
+            previousIndex = FindPreviousIndexOf(bucket, entryIndex);
+        }
+
+        if (previousIndex != -1) {
+            LinkOf(previousIndex).next = LinkOf(entryIndex).next;
+        } else {
+            buckets[bucket] = LinkOf(entryIndex).next;
+        }
+
+        auto *node = entries[entryIndex].node;
+
+        entries[entryIndex].node = nullptr;
+        LinkOf(entryIndex).next = deletedList;
+        deletedList = entryIndex;
+        deletedEntriesAmount++;
+
+        return node;
+    }
+
+    template <class...Args>
+    int CreateAndGetEntryIndex(size_t hash, Args&&... args) {
+        auto [bucket, index] = GetNextCreationBucketAndIndex(hash);
+
+        entries[index].hash = hash;
+        entries[index].node = IsInline()
+                              ? new (InlineNodeAt(index)) TNode(std::forward<Args>(args)...)
+                              : new TNode(std::forward<Args>(args)...);
+        LinkIntoBucket(bucket, index);
+
+        return index;
+    }
+
+    // Links a filled entry at the head of the chain, or at its place in the order of a sorted one.
+    void LinkIntoBucket(int bucket, int index) {
+        if constexpr (CanSortChains) {
+            if (auto *chain = FindSortedChain(bucket)) {
+                InsertIntoSortedChain(*chain, index);
+
+                return;
+            }
+        }
+
+        LinkOf(index) = Link{TagOf(entries[index].hash), buckets[bucket]};
+        buckets[bucket] = index;
+
+        if constexpr (CanSortChains) {
+            if (get_options().sortedChainMinLength != SIZE_MAX && IsChainLongerThan(bucket, get_options().sortedChainMinLength)) {
+                SortChain(bucket);
+            }
+        }
+    }
+
+    std::pair<int, int> GetNextCreationBucketAndIndex(size_t hash) {
+        if (capacity == 0) {
+            Initialize(0);
+        }
+
+        int index;
+        auto bucket = static_cast<int>(hash % capacity);
+
+        if (deletedEntriesAmount > 0) {
+            index = deletedList;
+            deletedList = LinkOf(deletedList).next;
+            deletedEntriesAmount--;
+        } else {
+            if (usedEntriesAmount == capacity) {
+                Enlarge();
+                bucket = static_cast<int>(hash % capacity);
+            }
+
+            index = static_cast<int>(usedEntriesAmount++);
+            // Keeps the slot harmless for clear() should the construction of its node throw.
+            entries[index].node = nullptr;
+        }
+
+        return std::make_pair(bucket, index);
+    }
+
+    int TryFindEntryIndex(const TKey &key, size_t hash) {
+        if (capacity == 0) {
+            return -1;
+        }
+
+        auto current = static_cast<int>(buckets[hash % capacity]);
+
+        if constexpr (CanSortChains) {
+            if (const auto *chain = FindSortedChain(static_cast<int>(hash % capacity))) {
+                return FindInSortedChain(*chain, key);
+            }
+        }
+
+        if constexpr (SplitLayout) {
+            const auto tag = TagOf(hash);
+
+            while (current >= 0) {
+                const auto &link = links[current];
+
+                if (link.tag == tag) {
+                    auto &entry = entries[current];
+
+                    if (hash == entry.hash && std::invoke(keyEqualComparer, key, KeyOfNode(entry))) {
+                        return current;
+                    }
+                }
+
+                current = link.next;
+            }
+        } else {
+            while (current >= 0) {
+                auto &entry = entries[current];
+
+                if (hash == entry.hash && std::invoke(keyEqualComparer, key, KeyOfNode(entry))) {
+                    return current;
+                }
+
+                current = entry.link.next;
+            }
+        }
+
+        return current;
+    }
+
+    void Enlarge() {
+        Rehash(PrimesHelper::ExpandPrime(capacity));
+    }
+
+    // Grows the arrays to `newCapacity` keeping entry indices. Entries are plain records, so the used prefix
+    // is carried over as bytes, by realloc for regular arrays, which may remap them instead of copying.
+    // The links of deleted entries come along untouched, and with them the deleted list; only the links
+    // of live entries are rebuilt.
+    void Rehash(size_t newCapacity) {
+        const auto oldCapacity = capacity;
+
+        if (newCapacity <= oldCapacity) {
+            return;
+        }
+
+        const auto newLargeTable = IsLarge(newCapacity);
+
+        if (IsInline()) {
+            const auto newArrays = AllocateArrays(newCapacity, newLargeTable);
+
+            std::memcpy(newArrays.entries, entries, sizeof(Entry) * usedEntriesAmount);
+            MoveInlineNodesTo(newArrays, newCapacity, newLargeTable);
+            UseArrays(newArrays);
+        } else if (!largeTable && !newLargeTable) {
+            auto *newBuckets = AllocateArray<int>(newCapacity, false);
+
+            try {
+                entries = Reallocate(entries, newCapacity);
+
+                if constexpr (SplitLayout) {
+                    links = Reallocate(links, newCapacity);
+                }
+            } catch (...) {
+                ReleaseArray(newBuckets, newCapacity, false);
+                throw;
+            }
+
+            ReleaseArray(buckets, oldCapacity, false);
+            buckets = newBuckets;
+        } else {
+            const auto newArrays = AllocateArrays(newCapacity, newLargeTable);
+
+            std::memcpy(newArrays.entries, entries, sizeof(Entry) * usedEntriesAmount);
+
+            if constexpr (SplitLayout) {
+                std::memcpy(newArrays.links, links, sizeof(Link) * usedEntriesAmount);
+            }
+
+            ReleaseArrays(Arrays{buckets, entries, links}, oldCapacity, largeTable);
+            UseArrays(newArrays);
+        }
+
+        capacity = newCapacity;
+        largeTable = newLargeTable;
+
+        // Chains are rebuilt from scratch, the long ones are found again once all entries are linked.
+        const auto hadSortedChains = sortedChains != nullptr;
+
+        sortedChains.reset();
+        std::memset(buckets, -1, sizeof(int) * capacity);
+
+        if (get_options().resizeThreadsCount > 1 && oldCapacity >= get_options().parallelResizeMinCapacity) {
+            RelinkInParallel();
+        } else {
+            for (size_t i = 0; i < usedEntriesAmount; i++) {
+                if (entries[i].node != nullptr) {
+                    auto &link = LinkOf(i);
+                    const auto bucket = static_cast<int>(entries[i].hash % capacity);
+
+                    link.tag = TagOf(entries[i].hash);
+                    link.next = buckets[bucket];
+                    buckets[bucket] = static_cast<int>(i);
+                }
+            }
+        }
+
+        if constexpr (CanSortChains) {
+            if (hadSortedChains) {
+                SortLongChains();
+            }
+        }
+    }
+
+    // Puts every inline node on the heap for the entries of `newArrays`. Like std::vector, nodes are copied
+    // when their move may throw, so a failure leaves the inline map as it was (only move-only nodes with
+    // throwing moves may be left moved from) and frees the heap nodes and `newArrays`. The inline
+    // originals are destroyed only once every node has its heap copy.
+    void MoveInlineNodesTo(const Arrays &newArrays, size_t newCapacity, bool newLargeTable) {
+        size_t moved = 0;
+
+        try {
+            for (; moved < usedEntriesAmount; moved++) {
+                if (entries[moved].node != nullptr) {
+                    newArrays.entries[moved].node = new TNode(std::move_if_noexcept(*entries[moved].node));
+                }
+            }
+        } catch (...) {
+            for (size_t i = 0; i < moved; i++) {
+                if (entries[i].node != nullptr) {
+                    if constexpr (std::is_nothrow_move_constructible_v<TNode>) {
+                        std::destroy_at(entries[i].node);
+                        std::construct_at(entries[i].node, std::move(*newArrays.entries[i].node));
+                    }
+
+                    delete newArrays.entries[i].node;
+                }
+            }
+
+            ReleaseArrays(newArrays, newCapacity, newLargeTable);
+            throw;
+        }
+
+        for (size_t i = 0; i < usedEntriesAmount; i++) {
+            if (entries[i].node != nullptr) {
+                std::destroy_at(entries[i].node);
+                entries[i].node = nullptr;
+            }
+        }
+    }
+
+    static void Prefetch(const void *address) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#else
+        (void) address;
+#endif
+    }
+
+    static uint32_t TagOf(size_t hash) {
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    static Link &LinkAt(const Arrays &arrays, size_t index) {
+        if constexpr (SplitLayout) {
+            return arrays.links[index];
+        } else {
+            return arrays.entries[index].link;
+        }
+    }
+
+    Link &LinkOf(size_t index) {
+        return LinkAt(Arrays{buckets, entries, links}, index);
+    }
+
+    const Link &LinkOf(size_t index) const {
+        return LinkAt(Arrays{buckets, entries, links}, index);
+    }
+
+    void UseArrays(const Arrays &arrays) {
+        buckets = arrays.buckets;
+        entries = arrays.entries;
+        links = arrays.links;
+    }
+
+    [[nodiscard]] bool IsLarge(size_t tableCapacity) const {
+        return sizeof(Entry) * tableCapacity >= get_options().hugePageMinBytes;
+    }
+
+    Arrays AllocateArrays(size_t count, bool large) const {
+        Arrays arrays{nullptr, nullptr, nullptr};
+
+        try {
+            arrays.buckets = AllocateArray<int>(count, large);
+            arrays.entries = AllocateArray<Entry>(count, large);
+
+            if constexpr (SplitLayout) {
+                arrays.links = AllocateArray<Link>(count, large);
+            }
+        } catch (...) {
+            ReleaseArrays(arrays, count, large);
+            throw;
+        }
+
+        return arrays;
+    }
+
+    // Arrays are left uninitialized, every element type is trivial.
+    template <class T>
+    T *AllocateArray(size_t count, bool large) const {
+        if (large) {
+            return static_cast<T *>(TableMemory::Map(sizeof(T) * count, get_options().numaPolicy, get_options().numaNodeMask));
+        }
+
+        auto *array = static_cast<T *>(std::malloc(sizeof(T) * count));
+
+        if (array == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        return array;
+    }
+
+    template <class T>
+    static T *Reallocate(T *array, size_t count) {
+        auto *grown = static_cast<T *>(std::realloc(array, sizeof(T) * count));
+
+        if (grown == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        return grown;
+    }
+
+    static void ReleaseArrays(const Arrays &arrays, size_t count, bool large) {
+        ReleaseArray(arrays.entries, count, large);
+        ReleaseArray(arrays.links, count, large);
+        ReleaseArray(arrays.buckets, count, large);
+    }
+
+    template <class T>
+    static void ReleaseArray(T *array, size_t count, bool large) {
+        if (array == nullptr) {
+            return;
+        }
+
+        if (large) {
+            TableMemory::Unmap(array, sizeof(T) * count);
+        } else {
+            std::free(array);
+        }
+    }
+
+    // Every worker relinks its own range of entries, so only bucket heads are shared between them.
+    // Exchanging a head publishes the entry and hands back the old head as its successor.
+    void RelinkInParallel() {
+        const auto threadsCount = get_options().resizeThreadsCount;
+        const auto length = (usedEntriesAmount + threadsCount - 1) / threadsCount;
+
+        Parallel::Run(threadsCount, [&](size_t part) {
+            const auto last = std::min(usedEntriesAmount, (part + 1) * length);
+
+            for (auto i = part * length; i < last; i++) {
+                if (entries[i].node != nullptr) {
+                    auto &link = LinkOf(i);
+                    auto head = std::atomic_ref<int>(buckets[entries[i].hash % capacity]);
+
+                    link.tag = TagOf(entries[i].hash);
+                    link.next = head.exchange(static_cast<int>(i), std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    // Walks at most length + 1 links.
+    [[nodiscard]] bool IsChainLongerThan(int bucket, size_t length) {
+        auto current = buckets[bucket];
+
+        for (size_t walked = 0; current >= 0; walked++) {
+            if (walked == length) {
+                return true;
+            }
+
+            current = LinkOf(current).next;
+        }
+
+        return false;
+    }
+
+    const SortedChain *FindSortedChain(int bucket) const {
+        return const_cast<HashTable *>(this)->FindSortedChain(bucket);
+    }
+
+    SortedChain *FindSortedChain(int bucket) {
+        if (sortedChains == nullptr) {
+            return nullptr;
+        }
+
+        const auto position = std::lower_bound(
+            sortedChains->begin(), sortedChains->end(), bucket,
+            [](const SortedChain &chain, int value) { return chain.bucket < value; });
+
+        return position != sortedChains->end() && position->bucket == bucket ? &*position : nullptr;
+    }
+
+    [[nodiscard]] size_t SortedChainsBytes() const {
+        if (sortedChains == nullptr) {
+            return 0;
+        }
+
+        auto bytes = sizeof(*sortedChains) + sortedChains->capacity() * sizeof(SortedChain);
+
+        for (const auto &chain : *sortedChains) {
+            bytes += chain.indices.capacity() * sizeof(int);
+        }
+
+        return bytes;
+    }
+
+    // Position of the first entry whose key is not less than `key`.
+    auto LowerBoundInChain(const SortedChain &chain, const TKey &key) requires CanSortChains {
+        return std::lower_bound(chain.indices.begin(), chain.indices.end(), key, [&](int index, const TKey &value) {
+            return KeyOfNode(entries[index]) < value;
+        });
+    }
+
+    int FindInSortedChain(const SortedChain &chain, const TKey &key) requires CanSortChains {
+        const auto position = LowerBoundInChain(chain, key);
+
+        return position != chain.indices.end() && !(key < KeyOfNode(entries[*position])) ? *position : -1;
+    }
+
+    void InsertIntoSortedChain(SortedChain &chain, int index) requires CanSortChains {
+        const auto position = chain.indices.insert(LowerBoundInChain(chain, KeyOfNode(entries[index])), index);
+        const auto next = position + 1 != chain.indices.end() ? *(position + 1) : -1;
+
+        LinkOf(index) = Link{TagOf(entries[index].hash), next};
+
+        if (position != chain.indices.begin()) {
+            LinkOf(*(position - 1)).next = index;
+        } else {
+            buckets[chain.bucket] = index;
+        }
+    }
+
+    // Drops the entry from the side array and returns its predecessor in the chain; chains shrunk to half
+    // the threshold stay sorted but lose the side array.
+    int RemoveFromSortedChain(SortedChain &chain, int entryIndex) requires CanSortChains {
+        const auto position = LowerBoundInChain(chain, KeyOfNode(entries[entryIndex]));
+        const auto previous = position != chain.indices.begin() ? *(position - 1) : -1;
+
+        chain.indices.erase(position);
+
+        if (chain.indices.size() <= get_options().sortedChainMinLength / 2) {
+            sortedChains->erase(sortedChains->begin() + (&chain - sortedChains->data()));
+
+            if (sortedChains->empty()) {
+                sortedChains.reset();
+            }
+        }
+
+        return previous;
+    }
+
+    // Relinks the chain of the bucket in key order and records its entries in a side array.
+    void SortChain(int bucket) requires CanSortChains {
+        SortedChain chain{bucket, {}};
+
+        for (auto current = buckets[bucket]; current >= 0; current = LinkOf(current).next) {
+            chain.indices.push_back(current);
+        }
+
+        std::sort(chain.indices.begin(), chain.indices.end(), [&](int left, int right) {
+            return KeyOfNode(entries[left]) < KeyOfNode(entries[right]);
+        });
+
+        buckets[bucket] = chain.indices.front();
+
+        for (size_t i = 0; i < chain.indices.size(); i++) {
+            LinkOf(chain.indices[i]).next = i + 1 < chain.indices.size() ? chain.indices[i + 1] : -1;
+        }
+
+        if (sortedChains == nullptr) {
+            sortedChains = std::make_unique<std::vector<SortedChain>>();
+        }
+
+        const auto position = std::lower_bound(
+            sortedChains->begin(), sortedChains->end(), bucket,
+            [](const SortedChain &other, int value) { return other.bucket < value; });
+
+        sortedChains->insert(position, std::move(chain));
+    }
+
+    void SortLongChains() requires CanSortChains {
+        for (size_t bucket = 0; bucket < capacity; bucket++) {
+            if (IsChainLongerThan(static_cast<int>(bucket), get_options().sortedChainMinLength)) {
+                SortChain(static_cast<int>(bucket));
+            }
+        }
+    }
+
+    // Entries are identified by their index, so the walk compares neither hashes nor keys.
+    int FindPreviousIndexOf(int bucket, int entryIndex) {
+        if (capacity == 0) {
+            return -1;
+        }
+
+        auto current = buckets[bucket];
+        auto previous = -1;
+
+        while (current >= 0 && current != entryIndex) {
+            previous = current;
+            current = LinkOf(current).next;
+        }
+
+        return previous;
+    }
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <ranges>
+#include <string_view>
+#include <type_traits>
+
+// Hashers for HashMap and friends, a drop-in replacement for std::hash.
+// Integers go through a full avalanche mixer instead of the identity, so keys differing only in high bits
+// or sharing a stride still spread over buckets. Strings and other contiguous ranges of plain values are hashed
+// by a wyhash style function reading 16 or 48 bytes per step through independent 64x64->128 bit multiplications.
+namespace FastHashing {
+    constexpr uint64_t Secrets[] = {
+        0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+    };
+
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 Product;
+#endif
+
+    // Replaces a and b with the low and the high half of their 128 bit product.
+    inline void Multiply(uint64_t &a, uint64_t &b) {
+#if defined(__SIZEOF_INT128__)
+        const auto product = static_cast<Product>(a) * b;
+
+        a = static_cast<uint64_t>(product);
+        b = static_cast<uint64_t>(product >> 64);
+#else
+        const auto aLow = a & 0xffffffffull, aHigh = a >> 32;
+        const auto bLow = b & 0xffffffffull, bHigh = b >> 32;
+        const auto low = aLow * bLow, middleA = aLow * bHigh, middleB = aHigh * bLow, high = aHigh * bHigh;
+        const auto carry = ((low >> 32) + (middleA & 0xffffffffull) + (middleB & 0xffffffffull)) >> 32;
+
+        a = low + (middleA << 32) + (middleB << 32);
+        b = high + (middleA >> 32) + (middleB >> 32) + carry;
+#endif
+    }
+
+    // Folds the 128 bit product of a and b into 64 bits.
+    inline uint64_t Mix(uint64_t a, uint64_t b) {
+        Multiply(a, b);
+
+        return a ^ b;
+    }
+
+    inline uint64_t Read8(const unsigned char *bytes) {
+        uint64_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+
+        return value;
+    }
+
+    inline uint64_t Read4(const unsigned char *bytes) {
+        uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+
+        return value;
+    }
+
+    inline uint64_t HashBytes(const void *data, size_t length, uint64_t seed) {
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        uint64_t a, b;
+
+        seed ^= Mix(seed ^ Secrets[0], Secrets[1]);
+
+        if (length <= 16) {
+            if (length >= 4) {
+                const auto shift = (length >> 3) << 2;
+
+                a = (Read4(bytes) << 32) | Read4(bytes + shift);
+                b = (Read4(bytes + length - 4) << 32) | Read4(bytes + length - 4 - shift);
+            } else if (length > 0) {
+                a = (uint64_t(bytes[0]) << 16) | (uint64_t(bytes[length >> 1]) << 8) | bytes[length - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            auto remaining = length;
+
+            if (remaining > 48) {
+                // Three lanes without data dependencies between them keep the multipliers busy.
+                auto second = seed, third = seed;
+
+                do {
+                    seed = Mix(Read8(bytes) ^ Secrets[1], Read8(bytes + 8) ^ seed);
+                    second = Mix(Read8(bytes + 16) ^ Secrets[2], Read8(bytes + 24) ^ second);
+                    third = Mix(Read8(bytes + 32) ^ Secrets[3], Read8(bytes + 40) ^ third);
+                    bytes += 48;
+                    remaining -= 48;
+                } while (remaining > 48);
+
+                seed ^= second ^ third;
+            }
+
+            while (remaining > 16) {
+                seed = Mix(Read8(bytes) ^ Secrets[1], Read8(bytes + 8) ^ seed);
+                bytes += 16;
+                remaining -= 16;
+            }
+
+            a = Read8(bytes + remaining - 16);
+            b = Read8(bytes + remaining - 8);
+        }
+
+        a ^= Secrets[1];
+        b ^= seed;
+        Multiply(a, b);
+
+        return Mix(a ^ Secrets[0] ^ length, b ^ Secrets[1]);
+    }
+
+    // The splitmix64 finalizer, every input bit affects every output bit.
+    inline uint64_t MixInteger(uint64_t value, uint64_t seed) {
+        value += seed + 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+
+        return value ^ (value >> 31);
+    }
+
+    // Drawn once per process, so hashes of the same key differ between runs.
+    inline uint64_t ProcessSeed() {
+        static const uint64_t seed = [] {
+            std::random_device device;
+
+            return (uint64_t(device()) << 32) ^ device();
+        }();
+
+        return seed;
+    }
+
+    template <class T>
+    constexpr bool IsHashedAsBytes = std::ranges::contiguous_range<const T>
+                                     && std::has_unique_object_representations_v<std::ranges::range_value_t<const T>>;
+}
+
+// Hashes integers, enums, pointers, strings and contiguous ranges of plain values such as std::span<const int>.
+// A seeded hasher is passed to the map constructor; SeededFastHash picks the per-process seed by itself.
+template <class T>
+struct FastHash {
+    FastHash() : seed(0) {
+    }
+
+    explicit FastHash(uint64_t seed) : seed(seed) {
+    }
+
+    size_t operator()(const T &value) const {
+        if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+            return static_cast<size_t>(FastHashing::MixInteger(static_cast<uint64_t>(value), seed));
+        } else if constexpr (std::is_pointer_v<T>) {
+            return static_cast<size_t>(FastHashing::MixInteger(reinterpret_cast<uintptr_t>(value), seed));
+        } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+            const std::string_view bytes = value;
+
+            return static_cast<size_t>(FastHashing::HashBytes(bytes.data(), bytes.size(), seed));
+        } else {
+            static_assert(FastHashing::IsHashedAsBytes<T>, "FastHash supports integers, strings and contiguous ranges of plain values");
+
+            return static_cast<size_t>(FastHashing::HashBytes(
+                std::ranges::data(value), std::ranges::size(value) * sizeof(std::ranges::range_value_t<const T>), seed));
+        }
+    }
+
+    uint64_t seed;
+};
+
+template <class T>
+struct SeededFastHash : FastHash<T> {
+    SeededFastHash() : FastHash<T>(FastHashing::ProcessSeed()) {
+    }
+};
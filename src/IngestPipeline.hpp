@@ -0,0 +1,420 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "HashMap.hpp"
+#include "Parallel.hpp"
+
+enum class IngestFormat {
+    // One "key,value" pair per line, the key ends at the first comma. Empty lines are skipped, "\r\n" is accepted.
+    Csv,
+    // Pairs as a 32 bit little endian key length, the key bytes, a 32 bit value length and the value bytes.
+    LengthPrefixed,
+};
+
+struct IngestOptions {
+    // Threads parsing and hashing chunks; one more thread inserts them.
+    size_t threadsCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+    // Parsed chunks waiting for insertion at most, bounds the memory held by the pipeline.
+    size_t pipelineDepth = 4;
+
+    // Chunks are cut at the first record boundary past every chunkBytes bytes.
+    size_t chunkBytes = 4 << 20;
+};
+
+// Seconds spent in every stage. Parsing and hashing run on several threads and are summed over them,
+// so bytes divided by a stage time is the throughput of one thread of that stage.
+struct IngestStats {
+    size_t bytes = 0;
+    size_t chunks = 0;
+    size_t records = 0;
+    size_t inserted = 0;
+    // Mapping or reading the file and cutting it into chunks.
+    double readSeconds = 0;
+    double parseSeconds = 0;
+    double hashSeconds = 0;
+    double insertSeconds = 0;
+    double totalSeconds = 0;
+};
+
+namespace IngestDetails {
+    inline double SecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Read only view of a whole file: a private mapping on Linux, one large read into a buffer elsewhere.
+    class InputFile {
+    public:
+        explicit InputFile(const std::string &path) {
+#if defined(__linux__)
+            const auto descriptor = open(path.c_str(), O_RDONLY);
+
+            if (descriptor == -1) {
+                throw std::runtime_error("cannot open " + path);
+            }
+
+            struct stat status {};
+
+            if (fstat(descriptor, &status) == -1) {
+                close(descriptor);
+
+                throw std::runtime_error("cannot stat " + path);
+            }
+
+            length = static_cast<size_t>(status.st_size);
+
+            if (length > 0) {
+                mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            }
+
+            close(descriptor);
+
+            if (mapped == MAP_FAILED) {
+                throw std::runtime_error("cannot map " + path);
+            }
+
+            if (mapped != nullptr) {
+                madvise(mapped, length, MADV_SEQUENTIAL);
+                bytes = static_cast<const char *>(mapped);
+            }
+#else
+            auto *file = std::fopen(path.c_str(), "rb");
+
+            if (file == nullptr) {
+                throw std::runtime_error("cannot open " + path);
+            }
+
+            constexpr size_t BlockLength = 16 << 20;
+            size_t read;
+
+            do {
+                buffer.resize(length + BlockLength);
+                read = std::fread(buffer.data() + length, 1, BlockLength, file);
+                length += read;
+            } while (read == BlockLength);
+
+            std::fclose(file);
+            bytes = buffer.data();
+#endif
+        }
+
+        InputFile(const InputFile &other) = delete;
+
+        InputFile &operator=(const InputFile &other) = delete;
+
+        ~InputFile() {
+#if defined(__linux__)
+            if (mapped != nullptr && mapped != MAP_FAILED) {
+                munmap(mapped, length);
+            }
+#endif
+        }
+
+        [[nodiscard]] std::string_view View() const {
+            return {bytes, length};
+        }
+
+    private:
+        const char *bytes = nullptr;
+        size_t length = 0;
+#if defined(__linux__)
+        void *mapped = nullptr;
+#else
+        std::vector<char> buffer;
+#endif
+    };
+
+    inline uint32_t ReadLength(const char *bytes) {
+        uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+
+        return value;
+    }
+
+    // Offset just past the length prefixed record starting at `offset`.
+    inline size_t SkipRecord(std::string_view input, size_t offset) {
+        for (auto field = 0; field < 2; field++) {
+            if (input.size() - offset < sizeof(uint32_t)) {
+                throw std::runtime_error("truncated length prefixed record");
+            }
+
+            const auto fieldLength = ReadLength(input.data() + offset);
+            offset += sizeof(uint32_t);
+
+            if (input.size() - offset < fieldLength) {
+                throw std::runtime_error("truncated length prefixed record");
+            }
+
+            offset += fieldLength;
+        }
+
+        return offset;
+    }
+
+    // Offsets of chunk starts followed by the input length. CSV chunks end after the first line break past
+    // every chunkBytes; length prefixed records cannot be found from the middle, so their lengths are hopped over.
+    inline std::vector<size_t> SplitChunks(std::string_view input, IngestFormat format, size_t chunkBytes) {
+        std::vector<size_t> bounds{0};
+
+        chunkBytes = std::max<size_t>(chunkBytes, 1);
+
+        if (format == IngestFormat::Csv) {
+            while (input.size() - bounds.back() > chunkBytes) {
+                const auto lineEnd = input.find('\n', bounds.back() + chunkBytes);
+
+                if (lineEnd == std::string_view::npos) {
+                    break;
+                }
+
+                bounds.push_back(lineEnd + 1);
+            }
+        } else {
+            for (size_t offset = 0; offset < input.size();) {
+                offset = SkipRecord(input, offset);
+
+                if (offset - bounds.back() >= chunkBytes && offset < input.size()) {
+                    bounds.push_back(offset);
+                }
+            }
+        }
+
+        if (bounds.back() != input.size()) {
+            bounds.push_back(input.size());
+        }
+
+        return bounds;
+    }
+
+    template <class TKey, class TValue>
+    struct Batch {
+        std::vector<std::pair<TKey, TValue>> items;
+        std::vector<size_t> hashes;
+    };
+
+    template <class TKey, class TValue>
+    void ParseChunk(std::string_view chunk, IngestFormat format, std::vector<std::pair<TKey, TValue>> &items) {
+        if (format == IngestFormat::Csv) {
+            while (!chunk.empty()) {
+                const auto lineEnd = chunk.find('\n');
+                auto line = chunk.substr(0, lineEnd);
+
+                chunk.remove_prefix(lineEnd != std::string_view::npos ? lineEnd + 1 : chunk.size());
+
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+
+                if (line.empty()) {
+                    continue;
+                }
+
+                const auto comma = line.find(',');
+
+                if (comma == std::string_view::npos) {
+                    throw std::runtime_error("CSV line without a comma: " + std::string(line));
+                }
+
+                items.emplace_back(TKey(line.substr(0, comma)), TValue(line.substr(comma + 1)));
+            }
+        } else {
+            // The chunk was cut at record boundaries by SplitChunks, which validated every length.
+            for (size_t offset = 0; offset < chunk.size();) {
+                const auto keyLength = ReadLength(chunk.data() + offset);
+                const auto key = chunk.substr(offset + sizeof(uint32_t), keyLength);
+
+                offset += sizeof(uint32_t) + keyLength;
+
+                const auto valueLength = ReadLength(chunk.data() + offset);
+                const auto value = chunk.substr(offset + sizeof(uint32_t), valueLength);
+
+                offset += sizeof(uint32_t) + valueLength;
+
+                items.emplace_back(TKey(key), TValue(value));
+            }
+        }
+    }
+}
+
+// Loads a file of key/value pairs into a HashMap whose key and value types are constructible from std::string_view.
+// The file is mapped and cut into chunks at record boundaries. Parser threads claim chunks in file order, parse
+// them into pairs and hash the keys of the whole chunk in one pass; the calling thread meanwhile inserts the
+// finished chunks in file order through HashMap::insert_bulk, so the first occurrence of a key wins as with
+// serial inserts. Parsers run at most pipelineDepth chunks ahead of the inserter.
+// Throws std::runtime_error for unreadable files and malformed records; pairs inserted before stay in the map.
+template <class TMap>
+IngestStats IngestFile(const std::string &path, IngestFormat format, TMap &map,
+                       const IngestOptions &options = IngestOptions()) {
+    using TKey = typename TMap::key_type;
+    using TValue = typename TMap::mapped_type;
+    using Batch = IngestDetails::Batch<TKey, TValue>;
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto threadsCount = std::max<size_t>(options.threadsCount, 1);
+    const auto depth = std::max<size_t>(options.pipelineDepth, 1);
+    IngestStats stats;
+
+    const IngestDetails::InputFile file(path);
+    const auto input = file.View();
+    const auto bounds = IngestDetails::SplitChunks(input, format, options.chunkBytes);
+    const auto chunksCount = bounds.size() - 1;
+
+    stats.bytes = input.size();
+    stats.chunks = chunksCount;
+    stats.readSeconds = IngestDetails::SecondsSince(start);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Batch> slots(depth);
+    std::vector<bool> ready(depth, false);
+    size_t claimedChunks = 0;
+    size_t insertedChunks = 0;
+    std::exception_ptr failure;
+
+    auto insertStage = [&] {
+        for (size_t chunk = 0; chunk < chunksCount; chunk++) {
+            Batch batch;
+
+            {
+                std::unique_lock lock(mutex);
+                changed.wait(lock, [&] { return ready[chunk % depth] || failure != nullptr; });
+
+                if (failure != nullptr) {
+                    return;
+                }
+
+                batch = std::move(slots[chunk % depth]);
+                ready[chunk % depth] = false;
+            }
+
+            const auto insertStart = std::chrono::steady_clock::now();
+
+            if (chunk == 0) {
+                // Chunks are about equally long, so the first one tells how many pairs the file holds.
+                map.reserve(map.size() + batch.items.size() * chunksCount);
+            }
+
+            stats.records += batch.items.size();
+            stats.inserted += map.insert_bulk(std::move(batch.items), batch.hashes);
+            stats.insertSeconds += IngestDetails::SecondsSince(insertStart);
+
+            {
+                std::lock_guard lock(mutex);
+                insertedChunks++;
+            }
+
+            changed.notify_all();
+        }
+    };
+
+    auto parseStage = [&] {
+        const auto &hasher = map.hash_function();
+        double parseSeconds = 0, hashSeconds = 0;
+
+        while (true) {
+            size_t chunk;
+
+            {
+                std::unique_lock lock(mutex);
+
+                if (claimedChunks == chunksCount || failure != nullptr) {
+                    break;
+                }
+
+                // Chunks are claimed in order, so the chunk the inserter waits for never waits itself.
+                chunk = claimedChunks++;
+                changed.wait(lock, [&] { return chunk < insertedChunks + depth || failure != nullptr; });
+            }
+
+            Batch batch;
+
+            try {
+                const auto parseStart = std::chrono::steady_clock::now();
+
+                IngestDetails::ParseChunk(input.substr(bounds[chunk], bounds[chunk + 1] - bounds[chunk]),
+                                          format, batch.items);
+
+                const auto hashStart = std::chrono::steady_clock::now();
+
+                batch.hashes.resize(batch.items.size());
+                for (size_t i = 0; i < batch.items.size(); i++) {
+                    batch.hashes[i] = std::invoke(hasher, batch.items[i].first);
+                }
+
+                parseSeconds += std::chrono::duration<double>(hashStart - parseStart).count();
+                hashSeconds += IngestDetails::SecondsSince(hashStart);
+            } catch (...) {
+                std::lock_guard lock(mutex);
+
+                if (failure == nullptr) {
+                    failure = std::current_exception();
+                }
+
+                changed.notify_all();
+
+                break;
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                slots[chunk % depth] = std::move(batch);
+                ready[chunk % depth] = true;
+            }
+
+            changed.notify_all();
+        }
+
+        std::lock_guard lock(mutex);
+        stats.parseSeconds += parseSeconds;
+        stats.hashSeconds += hashSeconds;
+    };
+
+    Parallel::Run(threadsCount + 1, [&](size_t task) {
+        if (task != 0) {
+            parseStage();
+
+            return;
+        }
+
+        try {
+            insertStage();
+        } catch (...) {
+            std::lock_guard lock(mutex);
+
+            if (failure == nullptr) {
+                failure = std::current_exception();
+            }
+
+            changed.notify_all();
+        }
+    });
+
+    if (failure != nullptr) {
+        std::rethrow_exception(failure);
+    }
+
+    stats.totalSeconds = IngestDetails::SecondsSince(start);
+
+    return stats;
+}
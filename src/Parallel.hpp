@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace Parallel {
+    // Calls action(i) for every i in [0, tasksCount), each on its own thread; task 0 runs on the caller.
+    // Every thread is joined before returning; if tasks threw, the exception of the lowest task is rethrown.
+    template <class Action>
+    void Run(size_t tasksCount, Action action) {
+        if (tasksCount == 0) {
+            return;
+        }
+
+        std::vector<std::exception_ptr> failures(tasksCount);
+        auto guarded = [&failures, action](size_t task) mutable {
+            try {
+                action(task);
+            } catch (...) {
+                failures[task] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(tasksCount - 1);
+
+        try {
+            for (size_t i = 1; i < tasksCount; i++) {
+                workers.emplace_back(guarded, i);
+            }
+        } catch (...) {
+            failures[0] = std::current_exception();
+        }
+
+        if (failures[0] == nullptr) {
+            guarded(0);
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+
+        for (const auto &failure : failures) {
+            if (failure != nullptr) {
+                std::rethrow_exception(failure);
+            }
+        }
+    }
+}
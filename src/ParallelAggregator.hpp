@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "HashMap.hpp"
+#include "Hashers.hpp"
+#include "Parallel.hpp"
+
+// Group-by over batches of (key, value) rows on several threads without locks.
+// Every batch is radix partitioned by the top bits of the mixed key hash: each thread sorts row indices of its
+// slice of the batch into per-partition lists, then each thread folds the rows of the partitions it owns into
+// their maps with `combine`. A key always lands in the same partition, so the partitions never share keys
+// and finalize() hands them out as they are.
+template<class TKey, class TValue, class Combine = std::plus<TValue>,
+         class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+class ParallelAggregator {
+public:
+    using Partition = HashMap<TKey, TValue, Hasher, KeyEqualComparer>;
+
+    explicit ParallelAggregator(size_t threadsCount = std::thread::hardware_concurrency(),
+                                Combine combine = Combine(),
+                                const Hasher &hasher = Hasher(),
+                                const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : combine(combine), hasher(hasher), keyEqualComparer(keyEqualComparer) {
+        this->threadsCount = std::max<size_t>(threadsCount, 1);
+        partitionBits = std::bit_width(std::bit_ceil(this->threadsCount) - 1);
+
+        const auto partitionsCount = size_t(1) << partitionBits;
+
+        partitions.reserve(partitionsCount);
+        for (size_t i = 0; i < partitionsCount; i++) {
+            partitions.emplace_back(HashMapOptions(), hasher, keyEqualComparer);
+        }
+
+        scattered.resize(this->threadsCount * partitionsCount);
+    }
+
+    [[nodiscard]] size_t partitions_count() const {
+        return partitions.size();
+    }
+
+    // Folds a random access range of (key, value) pairs into the partitions.
+    template <class Rows>
+    void consume(const Rows &rows) {
+        const auto rowsCount = static_cast<size_t>(std::size(rows));
+
+        if (partitions.size() == 1) {
+            for (size_t i = 0; i < rowsCount; i++) {
+                Fold(partitions[0], rows[i], std::invoke(hasher, rows[i].first));
+            }
+
+            return;
+        }
+
+        const auto sliceLength = (rowsCount + threadsCount - 1) / threadsCount;
+
+        Parallel::Run(threadsCount, [&](size_t thread) {
+            auto *lists = &scattered[thread * partitions.size()];
+            const auto last = std::min(rowsCount, (thread + 1) * sliceLength);
+
+            for (size_t i = 0; i < partitions.size(); i++) {
+                lists[i].clear();
+            }
+
+            for (auto i = thread * sliceLength; i < last; i++) {
+                const auto hash = std::invoke(hasher, rows[i].first);
+
+                lists[PartitionOf(hash)].push_back(ScatteredRow{i, hash});
+            }
+        });
+
+        // The scatter above has been joined, so the lists are only read from here on.
+        Parallel::Run(threadsCount, [&](size_t thread) {
+            for (auto partition = thread; partition < partitions.size(); partition += threadsCount) {
+                for (size_t source = 0; source < threadsCount; source++) {
+                    for (const auto &row : scattered[source * partitions.size() + partition]) {
+                        Fold(partitions[partition], rows[row.row], row.hash);
+                    }
+                }
+            }
+        });
+    }
+
+    // Hands out the partitions, whose key sets are disjoint, and leaves the aggregator empty.
+    // HashMap::merge joins them into one map by relinking nodes if a single map is needed.
+    std::vector<Partition> finalize() {
+        std::vector<Partition> result;
+        result.reserve(partitions.size());
+
+        for (auto &partition : partitions) {
+            result.push_back(std::move(partition));
+            partition = Partition(HashMapOptions(), hasher, keyEqualComparer);
+        }
+
+        return result;
+    }
+
+private:
+    Combine combine;
+    Hasher hasher;
+    KeyEqualComparer keyEqualComparer;
+    size_t threadsCount;
+    int partitionBits;
+    std::vector<Partition> partitions;
+    // A row of the batch with its key hash, which the fold reuses instead of hashing the key again.
+    struct ScatteredRow {
+        size_t row;
+        size_t hash;
+    };
+
+    // Rows of the current batch for every (thread, partition), kept to reuse their memory.
+    std::vector<std::vector<ScatteredRow>> scattered;
+
+    // Top bits of the mixed hash: the maps index buckets by the remainder of the raw hash, so they stay balanced.
+    size_t PartitionOf(size_t hash) const {
+        return static_cast<size_t>(FastHashing::MixInteger(hash, 0) >> (64 - partitionBits));
+    }
+
+    template <class Row>
+    void Fold(Partition &partition, const Row &row, size_t hash) {
+        partition.emplace_or_update_with_hash(row.first, hash, [&](TValue &accumulated) {
+            accumulated = std::invoke(combine, std::move(accumulated), row.second);
+        }, row.second);
+    }
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Byte encoding of keys and values in files written by the maps: strings as a 32 bit length and their bytes,
+// trivially copyable types as their object representation. Files are read back on the machine that wrote them.
+namespace RecordCodec {
+    template <class T>
+    constexpr bool IsString = std::is_same_v<T, std::string>;
+
+    template <class T>
+    void Append(std::string &output, const T &value) {
+        if constexpr (IsString<T>) {
+            const auto length = static_cast<uint32_t>(value.size());
+
+            output.append(reinterpret_cast<const char *>(&length), sizeof(length));
+            output.append(value);
+        } else {
+            static_assert(std::is_trivially_copyable_v<T>, "records hold strings and trivially copyable types");
+
+            output.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+    }
+
+    // Reads a value from the front of `input`, returns false if the input ends first.
+    template <class T>
+    bool Parse(std::string_view &input, T &value) {
+        if constexpr (IsString<T>) {
+            uint32_t length;
+
+            if (input.size() < sizeof(length)) {
+                return false;
+            }
+
+            std::memcpy(&length, input.data(), sizeof(length));
+            input.remove_prefix(sizeof(length));
+
+            if (input.size() < length) {
+                return false;
+            }
+
+            value.assign(input.data(), length);
+            input.remove_prefix(length);
+        } else {
+            if (input.size() < sizeof(value)) {
+                return false;
+            }
+
+            std::memcpy(&value, input.data(), sizeof(value));
+            input.remove_prefix(sizeof(value));
+        }
+
+        return true;
+    }
+}
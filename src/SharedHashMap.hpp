@@ -0,0 +1,438 @@
+#pragma once
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PrimesHelper.h"
+
+namespace SharedMapDetails {
+    constexpr uint64_t Magic = 0x70614d6465726853ull;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the sequence is shared between processes");
+
+    struct Header {
+        // Written last by the creator, a reader seeing it sees the whole initialized segment.
+        std::atomic<uint64_t> magic;
+        uint32_t keySize;
+        uint32_t valueSize;
+        // Odd while the writer changes the table; every completed change adds two.
+        std::atomic<uint64_t> sequence;
+        // Process of the writer, for readers to tell a long change from one its writer died in.
+        int64_t writerProcess;
+        uint64_t capacity;
+        uint64_t usedEntriesAmount;
+        uint64_t deletedEntriesAmount;
+        int64_t deletedList;
+    };
+
+    template <class TKey, class TValue>
+    struct Entry {
+        uint64_t hash;
+        int32_t next;
+        TKey key;
+        TValue value;
+    };
+
+    constexpr size_t AlignUp(size_t offset, size_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+// Map living in a POSIX shared memory segment, so processes on one host share a single copy.
+// The segment holds the header, buckets and entries with the pairs inline; chains are linked by indices as in
+// HashTable, so every process may map the segment at its own address. One process creates and updates the map,
+// any number of processes open it read only. Readers never block the writer: the writer makes the sequence odd
+// for the time of every change and readers repeat a lookup that overlapped one (a seqlock).
+// Keys and values are copied as bytes, so both must be trivially copyable, and the hasher has to give equal
+// hashes in every process, which rules out per-process seeds. The capacity is fixed when the map is created.
+template<class TKey, class TValue, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+class SharedHashMap {
+    static_assert(std::is_trivially_copyable_v<TKey> && std::is_trivially_copyable_v<TValue>,
+                  "pairs are shared between processes as bytes");
+
+    using Header = SharedMapDetails::Header;
+    using Entry = SharedMapDetails::Entry<TKey, TValue>;
+
+public:
+    // Creates the segment `name`, which starts with a slash, and opens it for writing. An existing segment is
+    // never reused: truncating it would make its readers fault on pages cut away under them. remove() the old
+    // name first, its readers keep their mapping.
+    static SharedHashMap create(const std::string &name, size_t capacity,
+                                const Hasher &hasher = Hasher(),
+                                const KeyEqualComparer &keyEqualComparer = KeyEqualComparer()) {
+        const auto tableCapacity = PrimesHelper::GetPrime(capacity);
+        const auto length = SegmentLength(tableCapacity);
+        const auto descriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+
+        if (descriptor == -1) {
+            throw std::runtime_error(errno == EEXIST ? "shared memory segment " + name + " already exists"
+                                                     : "cannot create shared memory segment " + name);
+        }
+
+        if (ftruncate(descriptor, static_cast<off_t>(length)) == -1) {
+            close(descriptor);
+            shm_unlink(name.c_str());
+
+            throw std::runtime_error("cannot size shared memory segment " + name);
+        }
+
+        void *segment;
+
+        try {
+            segment = Map(descriptor, length, true, name);
+        } catch (...) {
+            shm_unlink(name.c_str());
+            throw;
+        }
+
+        SharedHashMap map(segment, length, true, hasher, keyEqualComparer);
+        auto *header = new (map.segment) Header();
+
+        header->keySize = sizeof(TKey);
+        header->valueSize = sizeof(TValue);
+        header->sequence.store(0, std::memory_order_relaxed);
+        header->writerProcess = getpid();
+        header->capacity = tableCapacity;
+        header->usedEntriesAmount = header->deletedEntriesAmount = 0;
+        header->deletedList = -1;
+
+        map.UseSegment();
+        std::memset(map.buckets, -1, sizeof(int32_t) * tableCapacity);
+        header->magic.store(SharedMapDetails::Magic, std::memory_order_release);
+
+        return map;
+    }
+
+    // Maps an existing segment read only.
+    static SharedHashMap open(const std::string &name,
+                              const Hasher &hasher = Hasher(),
+                              const KeyEqualComparer &keyEqualComparer = KeyEqualComparer()) {
+        const auto descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+
+        if (descriptor == -1) {
+            throw std::runtime_error("cannot open shared memory segment " + name);
+        }
+
+        struct stat status {};
+
+        if (fstat(descriptor, &status) == -1 || static_cast<size_t>(status.st_size) < sizeof(Header)) {
+            close(descriptor);
+
+            throw std::runtime_error("not a shared map segment " + name);
+        }
+
+        const auto length = static_cast<size_t>(status.st_size);
+        SharedHashMap map(Map(descriptor, length, false, name), length, false, hasher, keyEqualComparer);
+        const auto *header = static_cast<const Header *>(map.segment);
+
+        if (header->magic.load(std::memory_order_acquire) != SharedMapDetails::Magic
+            || header->keySize != sizeof(TKey) || header->valueSize != sizeof(TValue)
+            || SegmentLength(header->capacity) != length) {
+            throw std::runtime_error("shared map segment " + name + " is not initialized or holds other types");
+        }
+
+        map.UseSegment();
+
+        return map;
+    }
+
+    // Removes the name; processes keep their mappings until they close them.
+    static void remove(const std::string &name) {
+        shm_unlink(name.c_str());
+    }
+
+    SharedHashMap(const SharedHashMap &other) = delete;
+
+    SharedHashMap(SharedHashMap &&other) noexcept
+        : hasher(std::move(other.hasher)), keyEqualComparer(std::move(other.keyEqualComparer)) {
+        segment = std::exchange(other.segment, nullptr);
+        segmentLength = std::exchange(other.segmentLength, 0);
+        writable = other.writable;
+        header = std::exchange(other.header, nullptr);
+        buckets = std::exchange(other.buckets, nullptr);
+        entries = std::exchange(other.entries, nullptr);
+    }
+
+    SharedHashMap &operator=(const SharedHashMap &other) = delete;
+
+    SharedHashMap &operator=(SharedHashMap &&other) noexcept {
+        if (&other != this) {
+            Unmap();
+
+            hasher = std::move(other.hasher);
+            keyEqualComparer = std::move(other.keyEqualComparer);
+            segment = std::exchange(other.segment, nullptr);
+            segmentLength = std::exchange(other.segmentLength, 0);
+            writable = other.writable;
+            header = std::exchange(other.header, nullptr);
+            buckets = std::exchange(other.buckets, nullptr);
+            entries = std::exchange(other.entries, nullptr);
+        }
+
+        return *this;
+    }
+
+    ~SharedHashMap() {
+        Unmap();
+    }
+
+    [[nodiscard]] bool read_only() const {
+        return !writable;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        return header->capacity;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return ReadConsistent([&] {
+            return static_cast<size_t>(header->usedEntriesAmount - header->deletedEntriesAmount);
+        });
+    }
+
+    // Number of completed changes, lets readers tell whether anything changed since they last looked.
+    [[nodiscard]] uint64_t version() const {
+        return WaitForEvenSequence() / 2;
+    }
+
+    std::optional<TValue> get(const TKey &key) const {
+        const auto hash = static_cast<uint64_t>(std::invoke(hasher, key));
+
+        return ReadConsistent([&]() -> std::optional<TValue> {
+            const auto index = FindEntryIndex(key, hash);
+
+            return index != -1 ? std::optional<TValue>(entries[index].value) : std::nullopt;
+        });
+    }
+
+    bool contains(const TKey &key) const {
+        const auto hash = static_cast<uint64_t>(std::invoke(hasher, key));
+
+        return ReadConsistent([&] {
+            return FindEntryIndex(key, hash) != -1;
+        });
+    }
+
+    // Returns true if the key was absent. Throws std::length_error when every entry is taken.
+    bool insert_or_assign(const TKey &key, const TValue &value) {
+        RequireWritable();
+
+        const auto hash = static_cast<uint64_t>(std::invoke(hasher, key));
+        const auto existing = FindEntryIndex(key, hash);
+
+        if (existing == -1 && header->deletedEntriesAmount == 0 && header->usedEntriesAmount == header->capacity) {
+            throw std::length_error("shared map is full");
+        }
+
+        BeginWrite();
+
+        if (existing != -1) {
+            entries[existing].value = value;
+        } else {
+            int32_t index;
+
+            if (header->deletedEntriesAmount > 0) {
+                index = static_cast<int32_t>(header->deletedList);
+                header->deletedList = entries[index].next;
+                header->deletedEntriesAmount--;
+            } else {
+                index = static_cast<int32_t>(header->usedEntriesAmount++);
+            }
+
+            auto &entry = entries[index];
+            auto &head = buckets[hash % header->capacity];
+
+            entry.hash = hash;
+            entry.key = key;
+            entry.value = value;
+            entry.next = head;
+            head = index;
+        }
+
+        EndWrite();
+
+        return existing == -1;
+    }
+
+    size_t erase(const TKey &key) {
+        RequireWritable();
+
+        const auto hash = static_cast<uint64_t>(std::invoke(hasher, key));
+        const auto index = FindEntryIndex(key, hash);
+
+        if (index == -1) {
+            return 0;
+        }
+
+        BeginWrite();
+
+        auto *link = &buckets[hash % header->capacity];
+
+        while (*link != index) {
+            link = &entries[*link].next;
+        }
+
+        *link = entries[index].next;
+        entries[index].next = static_cast<int32_t>(header->deletedList);
+        header->deletedList = index;
+        header->deletedEntriesAmount++;
+
+        EndWrite();
+
+        return 1;
+    }
+
+private:
+    Hasher hasher;
+    KeyEqualComparer keyEqualComparer;
+    // Spins a reader waits through an odd sequence between checks that the writer is still alive.
+    static constexpr size_t WriterCheckSpins = 1 << 12;
+
+    void *segment;
+    size_t segmentLength;
+    bool writable;
+    Header *header;
+    int32_t *buckets;
+    Entry *entries;
+
+    SharedHashMap(void *segment, size_t segmentLength, bool writable,
+                  const Hasher &hasher, const KeyEqualComparer &keyEqualComparer)
+        : hasher(hasher), keyEqualComparer(keyEqualComparer) {
+        this->segment = segment;
+        this->segmentLength = segmentLength;
+        this->writable = writable;
+        header = static_cast<Header *>(segment);
+        buckets = nullptr;
+        entries = nullptr;
+    }
+
+    static size_t BucketsOffset() {
+        return SharedMapDetails::AlignUp(sizeof(Header), alignof(Entry) > 64 ? alignof(Entry) : 64);
+    }
+
+    static size_t EntriesOffset(size_t capacity) {
+        return SharedMapDetails::AlignUp(BucketsOffset() + sizeof(int32_t) * capacity, alignof(Entry));
+    }
+
+    static size_t SegmentLength(size_t capacity) {
+        return EntriesOffset(capacity) + sizeof(Entry) * capacity;
+    }
+
+    static void *Map(int descriptor, size_t length, bool write, const std::string &name) {
+        auto *mapped = mmap(nullptr, length, write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, descriptor, 0);
+
+        close(descriptor);
+
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("cannot map shared memory segment " + name);
+        }
+
+        return mapped;
+    }
+
+    void Unmap() {
+        if (segment != nullptr) {
+            munmap(segment, segmentLength);
+            segment = nullptr;
+        }
+    }
+
+    void UseSegment() {
+        auto *bytes = static_cast<char *>(segment);
+
+        buckets = reinterpret_cast<int32_t *>(bytes + BucketsOffset());
+        entries = reinterpret_cast<Entry *>(bytes + EntriesOffset(header->capacity));
+    }
+
+    void RequireWritable() const {
+        if (!writable) {
+            throw std::logic_error("shared map is opened read only");
+        }
+    }
+
+    void BeginWrite() {
+        header->sequence.store(header->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void EndWrite() {
+        header->sequence.store(header->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // A writer dying in the middle of a change leaves the sequence odd for good, so a reader waiting that long
+    // checks whether the writer process still exists and throws std::runtime_error if it does not.
+    // A process id reused since then passes for the writer.
+    uint64_t WaitForEvenSequence() const {
+        for (size_t spins = 1;; spins++) {
+            const auto sequence = header->sequence.load(std::memory_order_acquire);
+
+            if (sequence % 2 == 0) {
+                return sequence;
+            }
+
+            if (spins % WriterCheckSpins == 0 && kill(static_cast<pid_t>(header->writerProcess), 0) == -1
+                && errno == ESRCH) {
+                throw std::runtime_error("the writer of the shared map died in the middle of a change");
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    // Repeats `read` until it ran while no change was in progress. The writer reads its own table directly.
+    template <class Read>
+    auto ReadConsistent(Read read) const {
+        if (writable) {
+            return read();
+        }
+
+        while (true) {
+            const auto before = WaitForEvenSequence();
+            auto result = read();
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (header->sequence.load(std::memory_order_relaxed) == before) {
+                return result;
+            }
+        }
+    }
+
+    // A reader may see a chain in the middle of a change, so indices are checked and the walk is bounded;
+    // whatever such a walk returns is thrown away by ReadConsistent.
+    int32_t FindEntryIndex(const TKey &key, uint64_t hash) const {
+        const auto capacity = header->capacity;
+        auto current = buckets[hash % capacity];
+
+        for (size_t walked = 0; current >= 0 && static_cast<uint64_t>(current) < capacity && walked < capacity; walked++) {
+            const auto &entry = entries[current];
+
+            if (entry.hash == hash && std::invoke(keyEqualComparer, key, entry.key)) {
+                return current;
+            }
+
+            current = entry.next;
+        }
+
+        return -1;
+    }
+};
+
+#endif
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "PrimesHelper.h"
+
+namespace SnapshotMapDetails {
+    constexpr size_t BucketPageLength = 1024;
+    constexpr size_t EntryPageLength = 128;
+
+    template <class TNode>
+    struct Entry {
+        size_t hash = 0;
+        int next = -1;
+        std::shared_ptr<const TNode> node;
+    };
+
+    // One version of the table. Pages are shared between versions and never change once shared.
+    template <class TNode>
+    struct PagedTable {
+        using BucketPage = std::array<int, BucketPageLength>;
+        using EntryPage = std::array<Entry<TNode>, EntryPageLength>;
+
+        size_t capacity = 0;
+        size_t usedEntriesAmount = 0;
+        size_t deletedEntriesAmount = 0;
+        int deletedList = -1;
+        std::vector<std::shared_ptr<BucketPage>> bucketPages;
+        // Pages past usedEntriesAmount are allocated lazily.
+        std::vector<std::shared_ptr<EntryPage>> entryPages;
+
+        [[nodiscard]] size_t Size() const {
+            return usedEntriesAmount - deletedEntriesAmount;
+        }
+
+        [[nodiscard]] int BucketAt(size_t index) const {
+            return (*bucketPages[index / BucketPageLength])[index % BucketPageLength];
+        }
+
+        const Entry<TNode> &EntryAt(size_t index) const {
+            return (*entryPages[index / EntryPageLength])[index % EntryPageLength];
+        }
+
+        template <class TKey, class KeyEqualComparer>
+        int Find(const TKey &key, size_t hash, const KeyEqualComparer &keyEqualComparer) const {
+            if (capacity == 0) {
+                return -1;
+            }
+
+            auto current = BucketAt(hash % capacity);
+
+            while (current >= 0) {
+                const auto &entry = EntryAt(current);
+
+                if (hash == entry.hash && std::invoke(keyEqualComparer, key, entry.node->first)) {
+                    return current;
+                }
+
+                current = entry.next;
+            }
+
+            return current;
+        }
+
+        template <class Function>
+        void ForEach(Function fn) const {
+            for (size_t i = 0; i < usedEntriesAmount; i++) {
+                const auto &entry = EntryAt(i);
+
+                if (entry.node != nullptr) {
+                    std::invoke(fn, *entry.node);
+                }
+            }
+        }
+    };
+}
+
+// Map handing out immutable snapshots in O(1).
+// Buckets and entries are split into fixed size pages that the map and its snapshots share by reference count.
+// The map copies a page only before changing one a snapshot still holds, so the first update after snapshot()
+// costs a copy of the page directory and every further one at most the pages it touches.
+// Pairs are immutable and shared too: assigning a value replaces the pair.
+// The map itself has a single writer; snapshots may be read, copied and dropped by any thread without locking.
+template<class TKey, class TValue, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+class SnapshotHashMap {
+    using KeyValuePair = std::pair<const TKey, TValue>;
+    using Table = SnapshotMapDetails::PagedTable<KeyValuePair>;
+    using Entry = SnapshotMapDetails::Entry<KeyValuePair>;
+
+public:
+    class Snapshot {
+    public:
+        [[nodiscard]] size_t size() const {
+            return table->Size();
+        }
+
+        // The pointer stays valid as long as any copy of the snapshot.
+        const TValue *get(const TKey &key) const {
+            const auto index = table->Find(key, std::invoke(hasher, key), keyEqualComparer);
+
+            return index != -1 ? &table->EntryAt(index).node->second : nullptr;
+        }
+
+        bool contains(const TKey &key) const {
+            return table->Find(key, std::invoke(hasher, key), keyEqualComparer) != -1;
+        }
+
+        // Calls fn(pair) for every pair of the snapshot.
+        template <class Function>
+        void for_each(Function fn) const {
+            table->ForEach(fn);
+        }
+
+    private:
+        friend class SnapshotHashMap;
+
+        Snapshot(std::shared_ptr<const Table> table, const Hasher &hasher, const KeyEqualComparer &keyEqualComparer)
+            : table(std::move(table)), hasher(hasher), keyEqualComparer(keyEqualComparer) {
+        }
+
+        std::shared_ptr<const Table> table;
+        Hasher hasher;
+        KeyEqualComparer keyEqualComparer;
+    };
+
+    explicit SnapshotHashMap(const Hasher &hasher = Hasher(),
+                             const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : hasher(hasher), keyEqualComparer(keyEqualComparer), table(std::make_shared<Table>()) {
+        copiedPagesAmount = 0;
+    }
+
+    SnapshotHashMap(const SnapshotHashMap &other) = delete;
+
+    SnapshotHashMap &operator=(const SnapshotHashMap &other) = delete;
+
+    [[nodiscard]] size_t size() const {
+        return table->Size();
+    }
+
+    // Pages copied because a snapshot was holding them.
+    [[nodiscard]] size_t copied_pages() const {
+        return copiedPagesAmount;
+    }
+
+    Snapshot snapshot() const {
+        return Snapshot(table, hasher, keyEqualComparer);
+    }
+
+    const TValue *get(const TKey &key) const {
+        const auto index = table->Find(key, std::invoke(hasher, key), keyEqualComparer);
+
+        return index != -1 ? &table->EntryAt(index).node->second : nullptr;
+    }
+
+    bool contains(const TKey &key) const {
+        return table->Find(key, std::invoke(hasher, key), keyEqualComparer) != -1;
+    }
+
+    // Returns true if the key was absent.
+    bool insert_or_assign(const TKey &key, TValue value) {
+        const auto hash = std::invoke(hasher, key);
+        auto node = std::make_shared<const KeyValuePair>(key, std::move(value));
+        auto &current = MutableTable();
+        const auto index = current.Find(key, hash, keyEqualComparer);
+
+        if (index != -1) {
+            MutableEntry(current, index).node = std::move(node);
+
+            return false;
+        }
+
+        LinkNode(hash, std::move(node));
+
+        return true;
+    }
+
+    size_t erase(const TKey &key) {
+        const auto hash = std::invoke(hasher, key);
+        const auto index = table->Find(key, hash, keyEqualComparer);
+
+        if (index == -1) {
+            return 0;
+        }
+
+        auto &current = MutableTable();
+        const auto bucket = hash % current.capacity;
+        const auto next = current.EntryAt(index).next;
+        auto previous = -1;
+
+        for (auto i = current.BucketAt(bucket); i != index; i = current.EntryAt(i).next) {
+            previous = i;
+        }
+
+        if (previous != -1) {
+            MutableEntry(current, previous).next = next;
+        } else {
+            MutableBucket(current, bucket) = next;
+        }
+
+        auto &entry = MutableEntry(current, index);
+
+        entry.node.reset();
+        entry.next = current.deletedList;
+        current.deletedList = index;
+        current.deletedEntriesAmount++;
+
+        return 1;
+    }
+
+    void clear() {
+        table = std::make_shared<Table>();
+    }
+
+    template <class Function>
+    void for_each(Function fn) const {
+        table->ForEach(fn);
+    }
+
+private:
+    using BucketPage = typename Table::BucketPage;
+    using EntryPage = typename Table::EntryPage;
+
+    Hasher hasher;
+    KeyEqualComparer keyEqualComparer;
+    std::shared_ptr<Table> table;
+    size_t copiedPagesAmount;
+
+    // A count of one means no snapshot can reach the object any more. The fence pairs with the release
+    // of the last snapshot reference, so its reads happen before the writes that follow.
+    template <class T>
+    static bool IsShared(const std::shared_ptr<T> &pointer) {
+        if (pointer.use_count() > 1) {
+            return true;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        return false;
+    }
+
+    Table &MutableTable() {
+        if (IsShared(table)) {
+            table = std::make_shared<Table>(*table);
+        }
+
+        return *table;
+    }
+
+    template <class TPage>
+    TPage &MutablePage(std::shared_ptr<TPage> &page) {
+        if (page == nullptr) {
+            page = std::make_shared<TPage>();
+        } else if (IsShared(page)) {
+            page = std::make_shared<TPage>(*page);
+            copiedPagesAmount++;
+        }
+
+        return *page;
+    }
+
+    int &MutableBucket(Table &current, size_t index) {
+        return MutablePage(current.bucketPages[index / SnapshotMapDetails::BucketPageLength])
+               [index % SnapshotMapDetails::BucketPageLength];
+    }
+
+    Entry &MutableEntry(Table &current, size_t index) {
+        return MutablePage(current.entryPages[index / SnapshotMapDetails::EntryPageLength])
+               [index % SnapshotMapDetails::EntryPageLength];
+    }
+
+    static void Initialize(Table &current, size_t capacity) {
+        current.capacity = capacity;
+
+        const auto bucketPagesCount =
+            (current.capacity + SnapshotMapDetails::BucketPageLength - 1) / SnapshotMapDetails::BucketPageLength;
+        const auto entryPagesCount =
+            (current.capacity + SnapshotMapDetails::EntryPageLength - 1) / SnapshotMapDetails::EntryPageLength;
+
+        current.bucketPages.resize(bucketPagesCount);
+        current.entryPages.resize(entryPagesCount);
+
+        for (auto &page : current.bucketPages) {
+            page = std::make_shared<BucketPage>();
+            page->fill(-1);
+        }
+    }
+
+    void LinkNode(size_t hash, std::shared_ptr<const KeyValuePair> &&node) {
+        auto *current = table.get();
+        int index;
+
+        if (current->capacity == 0) {
+            Initialize(*current, PrimesHelper::GetPrime(0));
+        }
+
+        if (current->deletedEntriesAmount > 0) {
+            index = current->deletedList;
+            current->deletedList = current->EntryAt(index).next;
+            current->deletedEntriesAmount--;
+        } else {
+            if (current->usedEntriesAmount == current->capacity) {
+                current = &Enlarge();
+            }
+
+            index = static_cast<int>(current->usedEntriesAmount++);
+        }
+
+        const auto bucket = hash % current->capacity;
+        auto &head = MutableBucket(*current, bucket);
+        auto &entry = MutableEntry(*current, index);
+
+        entry.hash = hash;
+        entry.node = std::move(node);
+        entry.next = head;
+        head = index;
+    }
+
+    // Builds a larger version from scratch, snapshots keep the old one.
+    Table &Enlarge() {
+        auto enlarged = std::make_shared<Table>();
+
+        Initialize(*enlarged, PrimesHelper::ExpandPrime(table->capacity));
+        enlarged->usedEntriesAmount = table->usedEntriesAmount;
+
+        for (size_t i = 0; i < table->usedEntriesAmount; i++) {
+            const auto &entry = table->EntryAt(i);
+            auto &copy = MutableEntry(*enlarged, i);
+            auto &head = MutableBucket(*enlarged, entry.hash % enlarged->capacity);
+
+            copy.hash = entry.hash;
+            copy.node = entry.node;
+            copy.next = head;
+            head = static_cast<int>(i);
+        }
+
+        table = std::move(enlarged);
+
+        return *table;
+    }
+};
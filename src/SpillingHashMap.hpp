@@ -0,0 +1,462 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "HashMap.hpp"
+#include "RecordCodec.hpp"
+
+struct SpillOptions {
+    // Bytes the resident partitions may hold: table arrays, nodes, heap buffers of string keys and values
+    // and the buffered writes of spilled partitions.
+    size_t memoryBudget = size_t(1) << 30;
+
+    size_t partitionsCount = 16;
+
+    // Spilled partitions go to files in a fresh subdirectory of this one, removed together with the map.
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+
+    // Writes to a spilled partition are collected up to this many bytes before they are appended to its file.
+    size_t writeBufferBytes = 256 << 10;
+};
+
+namespace SpillDetails {
+    enum class RecordKind : uint8_t {
+        Insert = 1,
+        Assign = 2,
+        Erase = 3,
+    };
+
+    // Heap bytes owned by a key or a value beyond its own object.
+    template <class T>
+    size_t HeapBytes(const T &value) {
+        if constexpr (RecordCodec::IsString<T>) {
+            return value.capacity() > std::string().capacity() ? value.capacity() + 1 : 0;
+        } else {
+            return 0;
+        }
+    }
+
+    // Partitions take the high half of a multiplied hash, tables inside them the hash modulo a prime,
+    // so keys of one partition still spread over all of its buckets.
+    inline size_t PartitionOf(size_t hash, size_t partitionsCount) {
+        return static_cast<size_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull) >> 32) % partitionsCount;
+    }
+
+    inline std::filesystem::path CreateSpillDirectory(const std::filesystem::path &parent) {
+        static std::atomic<uint64_t> sequence = std::random_device()();
+
+        std::filesystem::create_directories(parent);
+
+        while (true) {
+            auto directory = parent / ("spill-" + std::to_string(sequence++));
+
+            if (std::filesystem::create_directory(directory)) {
+                return directory;
+            }
+        }
+    }
+}
+
+// HashMap for data sets that may not fit in memory. Keys are split by hash into partitions, each a HashMap of its
+// own; when the resident partitions outgrow the memory budget, the least recently used ones are written to files
+// and dropped from memory. Writes to a spilled partition are appended to its file as records and applied in order
+// when the partition is loaded again, so insert keeps the first value of a key and insert_or_assign the last one
+// whatever was resident at the time. Lookups and partition visits load spilled partitions one at a time, spilling
+// colder ones to make room, so a merge over all pairs needs memory for one partition rather than the whole map.
+// A single partition larger than the budget stays resident; more partitions make that less likely.
+// Keys and values are strings or trivially copyable types.
+template<class TKey, class TValue, class Hasher = std::hash<TKey>, class KeyEqualComparer = std::equal_to<TKey>>
+class SpillingHashMap {
+public:
+    using Map = HashMap<TKey, TValue, Hasher, KeyEqualComparer>;
+
+    explicit SpillingHashMap(const SpillOptions &options = SpillOptions(),
+                             const Hasher &hasher = Hasher(),
+                             const KeyEqualComparer &keyEqualComparer = KeyEqualComparer())
+        : options(options), hasher(hasher), directory(SpillDetails::CreateSpillDirectory(options.directory)) {
+        this->options.partitionsCount = std::max<size_t>(options.partitionsCount, 1);
+        partitions.reserve(this->options.partitionsCount);
+
+        for (size_t i = 0; i < this->options.partitionsCount; i++) {
+            partitions.emplace_back(Map(HashMapOptions(), hasher, keyEqualComparer));
+        }
+    }
+
+    SpillingHashMap(const SpillingHashMap &other) = delete;
+
+    SpillingHashMap &operator=(const SpillingHashMap &other) = delete;
+
+    ~SpillingHashMap() {
+        std::error_code ignored;
+        std::filesystem::remove_all(directory, ignored);
+    }
+
+    [[nodiscard]] size_t partitions_count() const {
+        return partitions.size();
+    }
+
+    [[nodiscard]] size_t partition_of(const TKey &key) const {
+        return SpillDetails::PartitionOf(std::invoke(hasher, key), partitions.size());
+    }
+
+    [[nodiscard]] bool is_spilled(size_t partition) const {
+        return partitions[partition].spilled;
+    }
+
+    [[nodiscard]] size_t spilled_partitions() const {
+        return static_cast<size_t>(std::count_if(partitions.begin(), partitions.end(),
+                                                 [](const Partition &partition) { return partition.spilled; }));
+    }
+
+    // Bytes held by the resident partitions, compared against the budget.
+    [[nodiscard]] size_t memory_usage() const {
+        return residentBytes;
+    }
+
+    // Bytes written to spill files so far, rewrites of reloaded partitions included.
+    [[nodiscard]] size_t spilled_bytes() const {
+        return spilledBytes;
+    }
+
+    // Pairs of the resident partitions; pairs of spilled partitions are counted once they are loaded.
+    [[nodiscard]] size_t resident_size() const {
+        size_t size = 0;
+
+        for (const auto &partition : partitions) {
+            size += partition.map.size();
+        }
+
+        return size;
+    }
+
+    // Inserts the pair if the key is absent. Returns false if the key is known to be present; for a spilled
+    // partition that is not known, the insert is deferred and true is returned.
+    bool insert(const TKey &key, const TValue &value) {
+        return try_emplace(key, value);
+    }
+
+    template <class...Args>
+    bool try_emplace(const TKey &key, Args&&... args) {
+        return Update(partition_of(key), [&](Partition &partition) {
+            if (partition.spilled) {
+                Defer(partition, SpillDetails::RecordKind::Insert, key, TValue(std::forward<Args>(args)...));
+
+                return true;
+            }
+
+            const auto [inserted, position] = partition.map.try_emplace(key, std::forward<Args>(args)...);
+
+            if (inserted) {
+                partition.heapBytes += SpillDetails::HeapBytes(position->first) + SpillDetails::HeapBytes(position->second);
+            }
+
+            return inserted;
+        });
+    }
+
+    void insert_or_assign(const TKey &key, const TValue &value) {
+        Update(partition_of(key), [&](Partition &partition) {
+            if (partition.spilled) {
+                Defer(partition, SpillDetails::RecordKind::Assign, key, value);
+            } else {
+                Assign(partition, key, value);
+            }
+
+            return true;
+        });
+    }
+
+    void erase(const TKey &key) {
+        Update(partition_of(key), [&](Partition &partition) {
+            if (partition.spilled) {
+                Defer(partition, SpillDetails::RecordKind::Erase, key, nullptr);
+            } else {
+                Erase(partition, key);
+            }
+
+            return true;
+        });
+    }
+
+    // Loads the partition of the key if it was spilled. The pointer is valid until the next change of the map;
+    // changes made through it are not counted against the budget.
+    TValue *find(const TKey &key) {
+        auto &map = partition(partition_of(key));
+        const auto position = map.find(key);
+
+        return position != map.end() ? &position->second : nullptr;
+    }
+
+    bool contains(const TKey &key) {
+        return find(key) != nullptr;
+    }
+
+    // The partition with all deferred writes applied, loaded if it was spilled. The reference is valid until
+    // the next change of the map.
+    Map &partition(size_t index) {
+        auto &partition = partitions[index];
+
+        if (partition.spilled) {
+            Load(index);
+        }
+
+        partition.lastUse = ++useClock;
+
+        return partition.map;
+    }
+
+    // Calls fn(map) for the map of every partition in turn, loading spilled ones one at a time;
+    // partitions visited before are spilled again if the next one does not fit next to them.
+    template <class Function>
+    void for_each_partition(Function fn) {
+        for (size_t i = 0; i < partitions.size(); i++) {
+            std::invoke(fn, partition(i));
+        }
+    }
+
+private:
+    struct Partition {
+        explicit Partition(Map map) : map(std::move(map)) {
+        }
+
+        Map map;
+        bool spilled = false;
+        // Heap buffers of resident keys and values.
+        size_t heapBytes = 0;
+        size_t lastUse = 0;
+        // Records of a spilled partition not yet appended to its file.
+        std::string pending;
+    };
+
+    SpillOptions options;
+    Hasher hasher;
+    std::filesystem::path directory;
+    std::vector<Partition> partitions;
+    size_t residentBytes = 0;
+    size_t spilledBytes = 0;
+    size_t useClock = 0;
+
+    static size_t Footprint(const Partition &partition) {
+        return partition.map.memory_usage() + partition.heapBytes + partition.pending.size();
+    }
+
+    [[nodiscard]] std::filesystem::path FileOf(size_t index) const {
+        return directory / ("partition-" + std::to_string(index));
+    }
+
+    template <class Operation>
+    bool Update(size_t index, Operation operation) {
+        auto &partition = partitions[index];
+        const auto before = Footprint(partition);
+        const auto result = operation(partition);
+
+        residentBytes += Footprint(partition) - before;
+        partition.lastUse = ++useClock;
+
+        if (partition.pending.size() >= options.writeBufferBytes) {
+            Flush(index);
+        }
+
+        if (residentBytes > options.memoryBudget) {
+            EnforceBudget(index);
+        }
+
+        return result;
+    }
+
+    void Assign(Partition &partition, const TKey &key, const TValue &value) {
+        const auto position = partition.map.find(key);
+
+        if (position != partition.map.end()) {
+            partition.heapBytes -= SpillDetails::HeapBytes(position->second);
+            position->second = value;
+            partition.heapBytes += SpillDetails::HeapBytes(position->second);
+        } else {
+            const auto inserted = partition.map.try_emplace(key, value).second;
+
+            partition.heapBytes += SpillDetails::HeapBytes(inserted->first) + SpillDetails::HeapBytes(inserted->second);
+        }
+    }
+
+    void Erase(Partition &partition, const TKey &key) {
+        const auto position = partition.map.find(key);
+
+        if (position != partition.map.end()) {
+            partition.heapBytes -= SpillDetails::HeapBytes(position->first) + SpillDetails::HeapBytes(position->second);
+            partition.map.erase(position);
+        }
+    }
+
+    static void Defer(Partition &partition, SpillDetails::RecordKind kind, const TKey &key, const TValue &value) {
+        partition.pending.push_back(static_cast<char>(kind));
+        RecordCodec::Append(partition.pending, key);
+        RecordCodec::Append(partition.pending, value);
+    }
+
+    static void Defer(Partition &partition, SpillDetails::RecordKind kind, const TKey &key, std::nullptr_t) {
+        partition.pending.push_back(static_cast<char>(kind));
+        RecordCodec::Append(partition.pending, key);
+    }
+
+    // Appends `bytes` to the file of the partition, or replaces the file with them.
+    void WriteFile(size_t index, std::string_view bytes, bool append) {
+        std::ofstream file(FileOf(index), std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+        if (!file) {
+            throw std::runtime_error("cannot write spill file " + FileOf(index).string());
+        }
+
+        spilledBytes += bytes.size();
+    }
+
+    void Flush(size_t index) {
+        auto &partition = partitions[index];
+
+        if (partition.pending.empty()) {
+            return;
+        }
+
+        WriteFile(index, partition.pending, true);
+        residentBytes -= partition.pending.size();
+        partition.pending.clear();
+        partition.pending.shrink_to_fit();
+    }
+
+    // Spills the least recently used partitions other than `keep` until the resident ones fit the budget.
+    // Buffered writes of spilled partitions count against the budget too, and writing them out costs less
+    // than spilling a resident partition, so they go first, oldest first.
+    void EnforceBudget(size_t keep) {
+        while (residentBytes > options.memoryBudget) {
+            auto oldest = partitions.size();
+
+            for (size_t i = 0; i < partitions.size(); i++) {
+                const auto &partition = partitions[i];
+
+                if (partition.spilled && !partition.pending.empty()
+                    && (oldest == partitions.size() || partition.lastUse < partitions[oldest].lastUse)) {
+                    oldest = i;
+                }
+            }
+
+            if (oldest == partitions.size()) {
+                break;
+            }
+
+            Flush(oldest);
+        }
+
+        while (residentBytes > options.memoryBudget) {
+            auto coldest = partitions.size();
+
+            for (size_t i = 0; i < partitions.size(); i++) {
+                const auto &partition = partitions[i];
+
+                if (i != keep && !partition.spilled && partition.map.size() > 0
+                    && (coldest == partitions.size() || partition.lastUse < partitions[coldest].lastUse)) {
+                    coldest = i;
+                }
+            }
+
+            if (coldest == partitions.size()) {
+                break;
+            }
+
+            Spill(coldest);
+        }
+    }
+
+    void Spill(size_t index) {
+        auto &partition = partitions[index];
+        std::string bytes;
+
+        for (const auto &[key, value] : partition.map) {
+            bytes.push_back(static_cast<char>(SpillDetails::RecordKind::Insert));
+            RecordCodec::Append(bytes, key);
+            RecordCodec::Append(bytes, value);
+        }
+
+        WriteFile(index, bytes, false);
+
+        residentBytes -= Footprint(partition);
+        partition.map.clear();
+        partition.heapBytes = 0;
+        partition.spilled = true;
+    }
+
+    // The file is removed only once it was replayed in full; a partition that fails to load stays spilled
+    // with its file untouched.
+    void Load(size_t index) {
+        auto &partition = partitions[index];
+
+        Flush(index);
+
+        std::string content;
+        {
+            std::ifstream file(FileOf(index), std::ios::binary);
+
+            if (!file) {
+                throw std::runtime_error("cannot read spill file " + FileOf(index).string());
+            }
+
+            content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        try {
+            Replay(partition, content, index);
+        } catch (...) {
+            partition.map.clear();
+            partition.heapBytes = 0;
+            throw;
+        }
+
+        partition.spilled = false;
+        std::filesystem::remove(FileOf(index));
+
+        residentBytes += Footprint(partition);
+        partition.lastUse = ++useClock;
+        EnforceBudget(index);
+    }
+
+    void Replay(Partition &partition, std::string_view input, size_t index) {
+        TKey key;
+        TValue value;
+
+        while (!input.empty()) {
+            const auto kind = static_cast<SpillDetails::RecordKind>(input.front());
+            input.remove_prefix(1);
+
+            if (!RecordCodec::Parse(input, key)
+                || (kind != SpillDetails::RecordKind::Erase && !RecordCodec::Parse(input, value))) {
+                throw std::runtime_error("truncated spill file " + FileOf(index).string());
+            }
+
+            if (kind == SpillDetails::RecordKind::Insert) {
+                const auto [inserted, position] = partition.map.try_emplace(key, std::move(value));
+
+                if (inserted) {
+                    partition.heapBytes += SpillDetails::HeapBytes(position->first)
+                                           + SpillDetails::HeapBytes(position->second);
+                }
+            } else if (kind == SpillDetails::RecordKind::Assign) {
+                Assign(partition, key, value);
+            } else {
+                Erase(partition, key);
+            }
+        }
+    }
+};
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Hashers.hpp"
+#include "PrimesHelper.h"
+
+// Map from strings to values in which no key is a heap object of its own. Keys up to InlineKeyLength bytes
+// are stored in their entry; longer ones are appended to one arena owned by the map, and the entry keeps
+// their offset and first bytes, so most mismatches are rejected before the arena is touched.
+// Entries hold the values and are kept dense: an erase moves the last entry into the hole. The bytes of
+// erased keys stay in the arena until the table is rehashed or shrink_to_fit() copies the live ones over.
+// Lookups take std::string_view; string views handed out by the map are valid until the next change. A key
+// inserted may view bytes of the map itself, such as part of a stored key, it is copied before anything moves.
+template<class TValue, class Hasher = FastHash<std::string_view>>
+class StringKeyMap {
+public:
+    static constexpr size_t InlineKeyLength = 16;
+
+    using mapped_type = TValue;
+
+    explicit StringKeyMap(const Hasher &hasher = Hasher()) : hasher(hasher) {
+    }
+
+    [[nodiscard]] size_t size() const {
+        return entries.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return entries.empty();
+    }
+
+    [[nodiscard]] size_t bucket_count() const {
+        return buckets.size();
+    }
+
+    // Bytes of long keys in the arena, including those of erased keys not yet compacted away.
+    [[nodiscard]] size_t arena_bytes() const {
+        return arena.size();
+    }
+
+    // Heap bytes of buckets, entries and the arena; memory owned by values themselves is not counted.
+    [[nodiscard]] size_t memory_usage() const {
+        return buckets.capacity() * sizeof(int) + entries.capacity() * sizeof(Entry) + arena.capacity();
+    }
+
+    TValue *find(std::string_view key) {
+        const auto index = FindEntryIndex(key, HashOf(key));
+
+        return index != -1 ? &entries[index].value : nullptr;
+    }
+
+    const TValue *find(std::string_view key) const {
+        return const_cast<StringKeyMap *>(this)->find(key);
+    }
+
+    bool contains(std::string_view key) const {
+        return find(key) != nullptr;
+    }
+
+    // Returns the value of the key and whether it was inserted; the value is constructed only if it was.
+    template <class...Args>
+    std::pair<TValue *, bool> try_emplace(std::string_view key, Args&&... args) {
+        const auto hash = HashOf(key);
+        const auto index = FindEntryIndex(key, hash);
+
+        if (index != -1) {
+            return {&entries[index].value, false};
+        }
+
+        return {&CreateEntry(key, hash, std::forward<Args>(args)...).value, true};
+    }
+
+    bool insert(std::string_view key, const TValue &value) {
+        return try_emplace(key, value).second;
+    }
+
+    TValue &operator[](std::string_view key) {
+        return *try_emplace(key).first;
+    }
+
+    size_t erase(std::string_view key) {
+        const auto hash = HashOf(key);
+
+        if (buckets.empty()) {
+            return 0;
+        }
+
+        auto *link = &buckets[hash % buckets.size()];
+
+        while (*link != -1 && !KeyEquals(entries[*link], key, hash)) {
+            link = &entries[*link].next;
+        }
+
+        if (*link == -1) {
+            return 0;
+        }
+
+        const auto index = *link;
+        *link = entries[index].next;
+
+        if (entries[index].length > InlineKeyLength) {
+            arenaGarbage += entries[index].length;
+        }
+
+        MoveLastEntryTo(index);
+
+        return 1;
+    }
+
+    // Calls fn(key, value) for every pair in entry order.
+    template <class Function>
+    void for_each(Function fn) {
+        for (auto &entry : entries) {
+            std::invoke(fn, KeyOf(entry), entry.value);
+        }
+    }
+
+    template <class Function>
+    void for_each(Function fn) const {
+        for (const auto &entry : entries) {
+            std::invoke(fn, KeyOf(entry), entry.value);
+        }
+    }
+
+    void reserve(size_t count) {
+        if (count > buckets.size()) {
+            Rehash(PrimesHelper::GetPrime(count));
+        }
+    }
+
+    // Shrinks the table to the current size and compacts the arena.
+    void shrink_to_fit() {
+        if (entries.empty()) {
+            clear();
+
+            return;
+        }
+
+        Rehash(PrimesHelper::GetPrime(entries.size()));
+        entries.shrink_to_fit();
+        arena.shrink_to_fit();
+    }
+
+    void clear() {
+        buckets = {};
+        entries = {};
+        arena = {};
+        arenaGarbage = 0;
+    }
+
+private:
+    // Hashes are cut to 32 bits to keep entries small, bucket indices are taken from the cut hash.
+    struct Entry {
+        uint32_t hash;
+        int next;
+        uint32_t length;
+        // The key itself if it fits, otherwise its arena offset followed by its first bytes.
+        char bytes[InlineKeyLength];
+        TValue value;
+    };
+
+    static constexpr size_t PrefixLength = InlineKeyLength - sizeof(uint64_t);
+
+    Hasher hasher;
+    std::vector<int> buckets;
+    std::vector<Entry> entries;
+    std::vector<char> arena;
+    size_t arenaGarbage = 0;
+
+    uint32_t HashOf(std::string_view key) const {
+        return static_cast<uint32_t>(std::invoke(hasher, key));
+    }
+
+    static uint64_t OffsetOf(const Entry &entry) {
+        uint64_t offset;
+        std::memcpy(&offset, entry.bytes, sizeof(offset));
+
+        return offset;
+    }
+
+    [[nodiscard]] std::string_view KeyOf(const Entry &entry) const {
+        if (entry.length <= InlineKeyLength) {
+            return {entry.bytes, entry.length};
+        }
+
+        return {arena.data() + OffsetOf(entry), entry.length};
+    }
+
+    bool KeyEquals(const Entry &entry, std::string_view key, uint32_t hash) const {
+        if (entry.hash != hash || entry.length != key.size()) {
+            return false;
+        }
+
+        if (entry.length <= InlineKeyLength) {
+            return std::memcmp(entry.bytes, key.data(), key.size()) == 0;
+        }
+
+        return std::memcmp(entry.bytes + sizeof(uint64_t), key.data(), PrefixLength) == 0
+               && std::memcmp(arena.data() + OffsetOf(entry), key.data(), key.size()) == 0;
+    }
+
+    int FindEntryIndex(std::string_view key, uint32_t hash) const {
+        if (buckets.empty()) {
+            return -1;
+        }
+
+        auto current = buckets[hash % buckets.size()];
+
+        while (current != -1 && !KeyEquals(entries[current], key, hash)) {
+            current = entries[current].next;
+        }
+
+        return current;
+    }
+
+    // Stores a long key at the end of the arena and points the entry to it.
+    void StoreInArena(Entry &entry, std::string_view key) {
+        const uint64_t offset = arena.size();
+
+        arena.insert(arena.end(), key.begin(), key.end());
+        std::memcpy(entry.bytes, &offset, sizeof(offset));
+        std::memcpy(entry.bytes + sizeof(offset), key.data(), PrefixLength);
+    }
+
+    // Whether the bytes of `key` lie in the arena or in the entries, where a rehash or an append may move them.
+    bool ViewsOwnStorage(std::string_view key) const {
+        const auto within = [&](const char *begin, size_t length) {
+            return !std::less<const char *>()(key.data(), begin) && std::less<const char *>()(key.data(), begin + length);
+        };
+
+        return within(arena.data(), arena.capacity())
+               || within(reinterpret_cast<const char *>(entries.data()), entries.capacity() * sizeof(Entry));
+    }
+
+    template <class...Args>
+    Entry &CreateEntry(std::string_view key, uint32_t hash, Args&&... args) {
+        if (ViewsOwnStorage(key)) {
+            const std::string copy(key);
+
+            return CreateEntry(copy, hash, std::forward<Args>(args)...);
+        }
+
+        if (entries.size() == buckets.size()) {
+            Rehash(buckets.empty() ? PrimesHelper::GetPrime(1) : PrimesHelper::ExpandPrime(buckets.size()));
+        }
+
+        auto &entry = entries.emplace_back(Entry{hash, -1, static_cast<uint32_t>(key.size()), {},
+                                                 TValue(std::forward<Args>(args)...)});
+
+        if (key.size() <= InlineKeyLength) {
+            std::memcpy(entry.bytes, key.data(), key.size());
+        } else {
+            try {
+                StoreInArena(entry, key);
+            } catch (...) {
+                // The entry is not linked yet, so dropping it leaves the map as it was.
+                entries.pop_back();
+                throw;
+            }
+        }
+
+        auto &bucket = buckets[hash % buckets.size()];
+        entry.next = bucket;
+        bucket = static_cast<int>(entries.size() - 1);
+
+        return entry;
+    }
+
+    // Fills the hole at `index` with the last entry, whose chain is repointed to its new place.
+    void MoveLastEntryTo(int index) {
+        const auto last = static_cast<int>(entries.size() - 1);
+
+        if (index != last) {
+            auto *link = &buckets[entries[last].hash % buckets.size()];
+
+            while (*link != last) {
+                link = &entries[*link].next;
+            }
+
+            *link = index;
+            entries[index] = std::move(entries[last]);
+        }
+
+        entries.pop_back();
+    }
+
+    // Rebuilds the buckets for `newCapacity` entries, copying live long keys into a fresh arena
+    // if erases left garbage in the old one.
+    void Rehash(size_t newCapacity) {
+        if (arenaGarbage > 0) {
+            std::vector<char> compacted;
+            compacted.reserve(arena.size() - arenaGarbage);
+            arena.swap(compacted);
+
+            for (auto &entry : entries) {
+                if (entry.length > InlineKeyLength) {
+                    StoreInArena(entry, {compacted.data() + OffsetOf(entry), entry.length});
+                }
+            }
+
+            arenaGarbage = 0;
+        }
+
+        // A new vector rather than assign(), which would keep the capacity of a larger table.
+        buckets = std::vector<int>(newCapacity, -1);
+        entries.reserve(newCapacity);
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            auto &bucket = buckets[entries[i].hash % newCapacity];
+            entries[i].next = bucket;
+            bucket = static_cast<int>(i);
+        }
+    }
+};
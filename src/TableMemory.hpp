@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Placement of large bucket and entry arrays across NUMA nodes.
+enum class NumaPolicy {
+    // First touch, whatever the kernel does for the calling thread.
+    Default,
+    // Pages are spread round robin over the nodes of the mask.
+    Interleave,
+    // Pages are allocated on the nodes of the mask only.
+    Bind,
+};
+
+// Memory for tables too large to be served well by the regular allocator: mappings are aligned to huge pages,
+// so random accesses spread over the whole table need far fewer TLB entries.
+namespace TableMemory {
+    constexpr size_t HugePageSize = 2 << 20;
+
+    inline size_t MappedLength(size_t bytes) {
+        return (bytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+    }
+
+#if defined(__linux__)
+    // Placement is a hint: kernels without NUMA support or masks naming absent nodes leave the default policy.
+    inline void ApplyNumaPolicy(void *memory, size_t length, NumaPolicy policy, unsigned long nodeMask) {
+        constexpr int BindMode = 2;
+        constexpr int InterleaveMode = 3;
+
+        if (policy == NumaPolicy::Default) {
+            return;
+        }
+
+        const auto mode = policy == NumaPolicy::Bind ? BindMode : InterleaveMode;
+
+        syscall(SYS_mbind, memory, length, mode, &nodeMask, sizeof(nodeMask) * 8 + 1, 0);
+    }
+#endif
+
+    // Maps `bytes` of zeroed memory starting at a huge page boundary and asks for transparent huge pages.
+    inline void *Map(size_t bytes, NumaPolicy policy, unsigned long nodeMask) {
+#if defined(__linux__)
+        const auto length = MappedLength(bytes);
+        // Mapping one extra huge page leaves room to cut an aligned range out of whatever the kernel returns.
+        auto *mapped = mmap(nullptr, length + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mapped == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        const auto address = reinterpret_cast<uintptr_t>(mapped);
+        const auto aligned = (address + HugePageSize - 1) & ~(uintptr_t(HugePageSize) - 1);
+        const auto head = aligned - address;
+
+        if (head > 0) {
+            munmap(mapped, head);
+        }
+
+        munmap(reinterpret_cast<void *>(aligned + length), HugePageSize - head);
+
+        auto *memory = reinterpret_cast<void *>(aligned);
+
+        madvise(memory, length, MADV_HUGEPAGE);
+        ApplyNumaPolicy(memory, length, policy, nodeMask);
+
+        return memory;
+#else
+        (void) policy;
+        (void) nodeMask;
+
+        return ::operator new(MappedLength(bytes), std::align_val_t(HugePageSize));
+#endif
+    }
+
+    inline void Unmap(void *memory, size_t bytes) {
+#if defined(__linux__)
+        munmap(memory, MappedLength(bytes));
+#else
+        (void) bytes;
+
+        ::operator delete(memory, std::align_val_t(HugePageSize));
+#endif
+    }
+}